@@ -9,6 +9,7 @@
 #include "filestorage.h"
 #include "memorycalendar.h"
 
+#include <QTemporaryDir>
 #include <QTest>
 #include <QTimeZone>
 QTEST_MAIN(FileStorageTest)
@@ -149,4 +150,100 @@ void FileStorageTest::testSpecialChars()
     file.remove();
 }
 
+static Event::Ptr createEvent(const QString &uid, const QDate &date)
+{
+    Event::Ptr event(new Event());
+    event->setUid(uid);
+    event->setDtStart(QDateTime(date, QTime(10, 0), QTimeZone::utc()));
+    event->setDtEnd(QDateTime(date, QTime(11, 0), QTimeZone::utc()));
+    event->setSummary(QStringLiteral("Event %1").arg(uid));
+    return event;
+}
+
+void FileStorageTest::testJournaledSave()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath(QStringLiteral("journaled.ics"));
+    const QDate date(2023, 5, 1);
+
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    FileStorage fs(cal, fileName);
+    fs.setJournaled(true);
+    QVERIFY(fs.journaled());
+    QCOMPARE(fs.journalFileName(), fileName + QLatin1String(".journal"));
+
+    Event::Ptr recurring = createEvent(QStringLiteral("recurring"), date);
+    recurring->recurrence()->setDaily(1);
+    cal->addEvent(recurring);
+    Event::Ptr exception(recurring->clone());
+    exception->clearRecurrence();
+    exception->setRecurrenceId(recurring->dtStart().addDays(2));
+    exception->setSummary(QStringLiteral("Exception"));
+    cal->addEvent(exception);
+    cal->addEvent(createEvent(QStringLiteral("deleted"), date));
+
+    // The first save writes the whole calendar.
+    QVERIFY(fs.save());
+    QVERIFY(QFile::exists(fileName));
+    QVERIFY(!QFile::exists(fs.journalFileName()));
+    const QByteArray calendarData = [&fileName]() {
+        QFile file(fileName);
+        return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    }();
+
+    // Later ones only append the changes to the journal.
+    cal->addEvent(createEvent(QStringLiteral("added"), date.addDays(1)));
+    cal->deleteEvent(cal->event(QStringLiteral("deleted")));
+    recurring->setSummary(QStringLiteral("Changed"));
+    QVERIFY(fs.save());
+    QVERIFY(QFile::exists(fs.journalFileName()));
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), calendarData);
+    file.close();
+
+    MemoryCalendar::Ptr loaded(new MemoryCalendar(QTimeZone::utc()));
+    FileStorage loader(loaded, fileName);
+    QVERIFY(loader.load());
+    QVERIFY(loaded->event(QStringLiteral("added")));
+    QVERIFY(!loaded->event(QStringLiteral("deleted")));
+    QCOMPARE(loaded->event(QStringLiteral("recurring"))->summary(), QStringLiteral("Changed"));
+    QVERIFY(loaded->event(QStringLiteral("recurring"), exception->recurrenceId()));
+    QCOMPARE(loaded->rawEvents().count(), 3);
+
+    // A full save folds the journal into the calendar file.
+    QVERIFY(loader.save());
+    QVERIFY(!QFile::exists(fs.journalFileName()));
+    MemoryCalendar::Ptr reloaded(new MemoryCalendar(QTimeZone::utc()));
+    FileStorage reloader(reloaded, fileName);
+    QVERIFY(reloader.load());
+    QCOMPARE(reloaded->rawEvents().count(), 3);
+}
+
+void FileStorageTest::testJournalCompaction()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath(QStringLiteral("compacted.ics"));
+    const QDate date(2023, 5, 1);
+
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    FileStorage fs(cal, fileName);
+    fs.setJournaled(true);
+    fs.setCompactionThreshold(5);
+    QCOMPARE(fs.compactionThreshold(), 5);
+    QVERIFY(fs.save());
+
+    for (int i = 0; i < 10; ++i) {
+        cal->addEvent(createEvent(QString::number(i), date.addDays(i)));
+        QVERIFY(fs.save());
+    }
+    QVERIFY(fs.close());
+
+    MemoryCalendar::Ptr loaded(new MemoryCalendar(QTimeZone::utc()));
+    FileStorage loader(loaded, fileName);
+    QVERIFY(loader.load());
+    QCOMPARE(loaded->rawEvents().count(), 10);
+    QVERIFY(!QFile::exists(fileName + QLatin1String(".journal.compacting")));
+}
+
 #include "moc_testfilestorage.cpp"
@@ -22,6 +22,9 @@ private Q_SLOTS:
         and compares both incidences. The comparison should yield true.
     */
     void testSpecialChars();
+
+    void testJournaledSave();
+    void testJournalCompaction();
 };
 
 #endif
@@ -12,7 +12,9 @@
 #include "icalformat.h"
 #include "memorycalendar.h"
 #include "occurrenceiterator.h"
+#include "todo.h"
 
+#include <QTemporaryFile>
 #include <QTest>
 #include <QTimeZone>
 
@@ -527,4 +529,130 @@ void ICalFormatTest::testAllDaySchedulingMessage()
     QCOMPARE(parsedEvent->dtEnd().date(), event->dtEnd().date());
 }
 
+void ICalFormatTest::testStreamingLoad()
+{
+    // The time zone is defined after the event using it.
+    const QByteArray data(
+        "BEGIN:VCALENDAR\r\n"
+        "VERSION:2.0\r\n"
+        "PRODID:-//K Desktop Environment//NONSGML libkcal 4.3//EN\r\n"
+        "X-CUSTOM-CALENDAR-PROPERTY:value\r\n"
+        "BEGIN:VEVENT\r\n"
+        "UID:event-1\r\n"
+        "DTSTAMP:20230101T000000Z\r\n"
+        "DTSTART;TZID=Test/Zone:20230615T100000\r\n"
+        "DTEND;TZID=Test/Zone:20230615T110000\r\n"
+        "SUMMARY:Event\r\n"
+        "BEGIN:VALARM\r\n"
+        "ACTION:DISPLAY\r\n"
+        "TRIGGER:-PT15M\r\n"
+        "END:VALARM\r\n"
+        "END:VEVENT\r\n"
+        "BEGIN:VTODO\r\n"
+        "UID:todo-1\r\n"
+        "DTSTAMP:20230101T000000Z\r\n"
+        "SUMMARY:Todo\r\n"
+        "END:VTODO\r\n"
+        "BEGIN:VTIMEZONE\r\n"
+        "TZID:Test/Zone\r\n"
+        "BEGIN:STANDARD\r\n"
+        "DTSTART:19700101T000000\r\n"
+        "TZOFFSETFROM:+0300\r\n"
+        "TZOFFSETTO:+0300\r\n"
+        "END:STANDARD\r\n"
+        "END:VTIMEZONE\r\n"
+        "BEGIN:VJOURNAL\r\n"
+        "UID:journal-1\r\n"
+        "DTSTAMP:20230101T000000Z\r\n"
+        "DTSTART;VALUE=DATE:20230615\r\n"
+        "SUMMARY:Journal\r\n"
+        "END:VJOURNAL\r\n"
+        "END:VCALENDAR\r\n");
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write(data);
+    file.close();
+
+    ICalFormat format;
+    QVERIFY(!format.streamingLoad());
+    auto expected = MemoryCalendar::Ptr::create(QTimeZone::utc());
+    QVERIFY(format.load(expected, file.fileName()));
+
+    format.setStreamingLoad(true);
+    QVERIFY(format.streamingLoad());
+    auto calendar = MemoryCalendar::Ptr::create(QTimeZone::utc());
+    QVERIFY(format.load(calendar, file.fileName()));
+    QCOMPARE(format.loadedProductId(), QStringLiteral("-//K Desktop Environment//NONSGML libkcal 4.3//EN"));
+    QCOMPARE(calendar->nonKDECustomProperty("X-CUSTOM-CALENDAR-PROPERTY"), QStringLiteral("value"));
+
+    QCOMPARE(calendar->rawEvents().count(), 1);
+    QCOMPARE(calendar->rawTodos().count(), 1);
+    QCOMPARE(calendar->rawJournals().count(), 1);
+
+    const Event::Ptr event = calendar->event(QStringLiteral("event-1"));
+    QVERIFY(event);
+    QCOMPARE(event->dtStart(), QDateTime(QDate(2023, 6, 15), QTime(7, 0), Qt::UTC));
+    QCOMPARE(event->dtStart(), expected->event(QStringLiteral("event-1"))->dtStart());
+    QCOMPARE(event->alarms().count(), 1);
+    QVERIFY(*event == *expected->event(QStringLiteral("event-1")));
+    QVERIFY(*calendar->todo(QStringLiteral("todo-1")) == *expected->todo(QStringLiteral("todo-1")));
+    QVERIFY(*calendar->journal(QStringLiteral("journal-1")) == *expected->journal(QStringLiteral("journal-1")));
+
+    // Empty files are valid, files without a calendar are not.
+    QTemporaryFile emptyFile;
+    QVERIFY(emptyFile.open());
+    emptyFile.write("\r\n");
+    emptyFile.close();
+    QVERIFY(format.load(MemoryCalendar::Ptr::create(QTimeZone::utc()), emptyFile.fileName()));
+
+    QTemporaryFile invalidFile;
+    QVERIFY(invalidFile.open());
+    invalidFile.write("BEGIN:VEVENT\r\nUID:x\r\nEND:VEVENT\r\n");
+    invalidFile.close();
+    QVERIFY(!format.load(MemoryCalendar::Ptr::create(QTimeZone::utc()), invalidFile.fileName()));
+}
+
+void ICalFormatTest::testParallelLoad()
+{
+    auto source = MemoryCalendar::Ptr::create(QTimeZone::utc());
+    for (int i = 0; i < 500; ++i) {
+        Incidence::Ptr incidence;
+        if (i % 3 == 0) {
+            incidence = Todo::Ptr::create();
+        } else {
+            incidence = Event::Ptr::create();
+        }
+        incidence->setUid(QStringLiteral("incidence-%1").arg(i));
+        incidence->setSummary(QStringLiteral("Incidence %1").arg(i));
+        incidence->setDtStart(QDateTime(QDate(2023, 1, 1).addDays(i), QTime(9, 0), QTimeZone("Europe/Paris")));
+        if (i % 5 == 0) {
+            incidence->recurrence()->setWeekly(1);
+        }
+        source->addIncidence(incidence);
+    }
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.close();
+    ICalFormat format;
+    QVERIFY(format.save(source, file.fileName()));
+
+    auto expected = MemoryCalendar::Ptr::create(QTimeZone::utc());
+    QVERIFY(format.load(expected, file.fileName()));
+
+    format.setLoadThreadCount(4);
+    QCOMPARE(format.loadThreadCount(), 4);
+    auto calendar = MemoryCalendar::Ptr::create(QTimeZone::utc());
+    QVERIFY(format.load(calendar, file.fileName()));
+
+    QCOMPARE(calendar->incidences().count(), 500);
+    const Incidence::List incidences = expected->incidences();
+    for (const Incidence::Ptr &incidence : incidences) {
+        const Incidence::Ptr loaded = calendar->incidence(incidence->uid());
+        QVERIFY(loaded);
+        QVERIFY(*loaded == *incidence);
+    }
+}
+
 #include "moc_testicalformat.cpp"
@@ -32,6 +32,8 @@ private Q_SLOTS:
     void testIcalFormat();
     void testNonTextCustomProperties();
     void testAllDaySchedulingMessage();
+    void testStreamingLoad();
+    void testParallelLoad();
 };
 
 #endif
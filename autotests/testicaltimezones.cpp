@@ -227,9 +227,26 @@ void ICalTimeZonesTest::parse()
     ICalTimeZoneParser parser(&timezones);
     parser.parse(vcalendar);
 
+    // Time zones resolved by the first parse are reused by the second one.
+    ICalTimeZoneCache timezones2;
+    ICalTimeZoneParser parser2(&timezones2);
+    parser2.parse(vcalendar);
+
     icalcomponent_free(vcalendar);
 
     QCOMPARE(timezones.tzForTime(onDate, origTz).id(), expTz);
+    QCOMPARE(timezones2.tzForTime(onDate, origTz).id(), expTz);
+}
+
+void ICalTimeZonesTest::tzForTimeAvailable()
+{
+    // TZIDs without a VTIMEZONE resolve to the system time zones, repeatedly.
+    const ICalTimeZoneCache timezones;
+    const QDateTime dt({2024, 3, 29}, {12, 0});
+    for (int i = 0; i < 2; ++i) {
+        QCOMPARE(timezones.tzForTime(dt, "Europe/Prague"), QTimeZone("Europe/Prague"));
+        QVERIFY(!timezones.tzForTime(dt, "No/Such_Zone").isValid());
+    }
 }
 
 void ICalTimeZonesTest::write()
@@ -262,6 +279,23 @@ void ICalTimeZonesTest::write()
         expect.replace(";VALUE=DATE-TIME", ""); // krazy:exclude=doublequote_chars
         QCOMPARE(vtimezone, expect);
     }
+
+    /* Generated components are cached, so converting the same zone again
+     * must give the same VTIMEZONE.
+     */
+    {
+        const QTimeZone prague("Europe/Prague");
+        const QDateTime earliest({1979, 2, 1}, {0, 0});
+        icaltimezone *tz1 = ICalTimeZoneParser::icaltimezoneFromQTimeZone(prague, earliest);
+        icaltimezone *tz2 = ICalTimeZoneParser::icaltimezoneFromQTimeZone(prague, earliest);
+        const QByteArray vtimezone1(icalcomponent_as_ical_string(icaltimezone_get_component(tz1)));
+        const QByteArray vtimezone2(icalcomponent_as_ical_string(icaltimezone_get_component(tz2)));
+        icalmemory_free_ring();
+        icaltimezone_free(tz1, 1);
+        icaltimezone_free(tz2, 1);
+        QVERIFY(vtimezone1.contains("TZID:Europe/Prague"));
+        QCOMPARE(vtimezone2, vtimezone1);
+    }
 }
 
 icalcomponent *loadCALENDAR(const char *vcal)
@@ -24,6 +24,7 @@ private Q_SLOTS:
     void testPragueTransitions();
     void parse_data();
     void parse();
+    void tzForTimeAvailable();
     void write();
 };
 
@@ -7,13 +7,20 @@
 */
 
 #include "testmemorycalendar.h"
+#include "calfilter.h"
 #include "filestorage.h"
 #include "memorycalendar.h"
+#include "sorting.h"
 
 #include <QDebug>
 
 #include <QTest>
+#include <QThread>
 #include <QTimeZone>
+
+#include <atomic>
+#include <memory>
+#include <vector>
 QTEST_MAIN(MemoryCalendarTest)
 
 using namespace KCalendarCore;
@@ -369,6 +376,179 @@ void MemoryCalendarTest::testRawEvents()
     QCOMPARE(cal->rawEvents(QDate(2020, 10, 11), QDate(), QTimeZone(), true).count(), 1);
 }
 
+void MemoryCalendarTest::testRawEventsIndexUpdate()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+
+    Event::Ptr event = Event::Ptr(new Event());
+    event->setDtStart(QDateTime(QDate(2022, 3, 1), QTime(10, 0), QTimeZone::utc()));
+    event->setDtEnd(QDateTime(QDate(2022, 3, 1), QTime(11, 0), QTimeZone::utc()));
+    QVERIFY(cal->addEvent(event));
+
+    Event::Ptr longEvent = Event::Ptr(new Event());
+    longEvent->setDtStart(QDateTime(QDate(2022, 1, 1), QTime(0, 0), QTimeZone::utc()));
+    longEvent->setDtEnd(QDateTime(QDate(2022, 12, 31), QTime(0, 0), QTimeZone::utc()));
+    QVERIFY(cal->addEvent(longEvent));
+
+    QCOMPARE(cal->rawEvents(QDate(2022, 3, 1), QDate(2022, 3, 1)).count(), 2);
+    QCOMPARE(cal->rawEvents(QDate(2022, 6, 1), QDate(2022, 6, 1)).count(), 1);
+
+    // Moving an event is reflected by range queries.
+    event->setDtStart(QDateTime(QDate(2023, 3, 1), QTime(10, 0), QTimeZone::utc()));
+    event->setDtEnd(QDateTime(QDate(2023, 3, 1), QTime(11, 0), QTimeZone::utc()));
+    QCOMPARE(cal->rawEvents(QDate(2022, 3, 1), QDate(2022, 3, 1)).count(), 1);
+    QCOMPARE(cal->rawEvents(QDate(2023, 3, 1), QDate(2023, 3, 1)).count(), 1);
+
+    // Making it recur is also taken into account.
+    event->recurrence()->setDaily(1);
+    event->recurrence()->setDuration(10);
+    QCOMPARE(cal->rawEvents(QDate(2023, 3, 5), QDate(2023, 3, 5)).count(), 1);
+    QCOMPARE(cal->rawEvents(QDate(2023, 3, 20), QDate(2023, 3, 20)).count(), 0);
+    event->recurrence()->setDuration(-1);
+    QCOMPARE(cal->rawEvents(QDate(2030, 1, 1), QDate(2030, 1, 1)).count(), 1);
+    event->recurrence()->clear();
+    QCOMPARE(cal->rawEvents(QDate(2030, 1, 1), QDate(2030, 1, 1)).count(), 0);
+    QCOMPARE(cal->rawEvents(QDate(2023, 3, 1), QDate(2023, 3, 1)).count(), 1);
+
+    QVERIFY(cal->deleteIncidence(longEvent));
+    QCOMPARE(cal->rawEvents(QDate(2022, 6, 1), QDate(2022, 6, 1)).count(), 0);
+    QCOMPARE(cal->rawEvents(QDate(), QDate()).count(), 1);
+}
+
+static void compareEventsForDates(const MemoryCalendar::Ptr &cal, const QDate &from, const QDate &to)
+{
+    // A snapshot still checks every recurring event for each date.
+    const MemoryCalendar::Snapshot snapshot = cal->snapshot();
+    for (QDate date = from; date <= to; date = date.addDays(1)) {
+        const Event::List events = cal->rawEventsForDate(date, QTimeZone(), EventSortSummary);
+        const Event::List expected = snapshot.rawEventsForDate(date, QTimeZone(), EventSortSummary);
+        QCOMPARE(events.count(), expected.count());
+        for (int i = 0; i < events.count(); ++i) {
+            QCOMPARE(events.at(i)->uid(), expected.at(i)->uid());
+        }
+    }
+}
+
+void MemoryCalendarTest::testRecurringEventsForDate()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone("Europe/Berlin")));
+    const QDate today = QDate::currentDate();
+    const QDate from = today.addMonths(-2);
+    const QDate to = today.addMonths(2);
+
+    Event::Ptr daily(new Event);
+    daily->setSummary(QStringLiteral("daily"));
+    daily->setDtStart(QDateTime(from.addDays(-10), QTime(23, 30), QTimeZone("America/New_York")));
+    daily->setDtEnd(daily->dtStart().addSecs(3600));
+    daily->recurrence()->setDaily(3);
+    daily->recurrence()->addExDate(from.addDays(11));
+    QVERIFY(cal->addEvent(daily));
+
+    Event::Ptr allDay(new Event);
+    allDay->setSummary(QStringLiteral("all day"));
+    allDay->setDtStart(QDateTime(from, QTime(0, 0)));
+    allDay->setDtEnd(QDateTime(from.addDays(2), QTime(0, 0)));
+    allDay->setAllDay(true);
+    allDay->recurrence()->setWeekly(1);
+    QVERIFY(cal->addEvent(allDay));
+
+    Event::Ptr multiDay(new Event);
+    multiDay->setSummary(QStringLiteral("multi day"));
+    multiDay->setDtStart(QDateTime(from.addDays(-40), QTime(18, 0), QTimeZone("Europe/Berlin")));
+    multiDay->setDtEnd(multiDay->dtStart().addDays(3));
+    multiDay->recurrence()->setMonthly(1);
+    multiDay->recurrence()->addMonthlyDate(from.addDays(-40).day());
+    QVERIFY(cal->addEvent(multiDay));
+
+    Event::Ptr single(new Event);
+    single->setSummary(QStringLiteral("single"));
+    single->setDtStart(QDateTime(today, QTime(12, 0), QTimeZone("Europe/Berlin")));
+    single->setDtEnd(single->dtStart().addSecs(3600));
+    QVERIFY(cal->addEvent(single));
+
+    compareEventsForDates(cal, from, to);
+
+    // Indexed days follow changes to the recurrence.
+    daily->recurrence()->setDuration(20);
+    allDay->recurrence()->addRDate(today.addDays(3));
+    single->recurrence()->setWeekly(2);
+    compareEventsForDates(cal, from, to);
+
+    // Changes to the dates of an event as well.
+    multiDay->setDtStart(multiDay->dtStart().addDays(1));
+    multiDay->setDtEnd(multiDay->dtStart().addDays(1));
+    compareEventsForDates(cal, from, to);
+
+    QVERIFY(cal->deleteEvent(allDay));
+    compareEventsForDates(cal, from, to);
+    QVERIFY(cal->addEvent(allDay));
+    compareEventsForDates(cal, from, to);
+
+    cal->setTimeZoneId("Asia/Tokyo");
+    compareEventsForDates(cal, from, to);
+
+    // Dates outside the indexed window still work.
+    compareEventsForDates(cal, today.addYears(3), today.addYears(3).addDays(7));
+}
+
+static bool occursOn(const Event::Ptr &event, const QDate &date, const QTimeZone &ts)
+{
+    if (event->recurs()) {
+        const int extraDays = event->isMultiDay() ? event->dtStart().date().daysTo(event->dtEnd().date()) : 0;
+        for (int i = 0; i <= extraDays; ++i) {
+            if (event->recursOn(date.addDays(-i), ts)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (event->isMultiDay()) {
+        return event->dtStart().toTimeZone(ts).date() <= date && event->dtEnd().toTimeZone(ts).date() >= date;
+    }
+    return event->dtStart().toTimeZone(ts).date() == date;
+}
+
+void MemoryCalendarTest::testEventsForDateInOtherTimeZone()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    const QTimeZone zones[] = {QTimeZone("Pacific/Auckland"), QTimeZone("America/Los_Angeles"), QTimeZone("Asia/Kolkata")};
+    const QDate first(2024, 3, 1);
+
+    for (int i = 0; i < 60; ++i) {
+        Event::Ptr event(new Event);
+        event->setSummary(QString::number(i));
+        event->setDtStart(QDateTime(first.addDays(i / 2), QTime((i * 5) % 24, 30), zones[i % 3]));
+        event->setDtEnd(event->dtStart().addSecs(3600 * (i % 4 == 0 ? 60 : 2)));
+        if (i % 5 == 0) {
+            event->recurrence()->setWeekly(1);
+            event->recurrence()->setDuration(i % 10 == 0 ? -1 : 4);
+        }
+        QVERIFY(cal->addEvent(event));
+    }
+
+    for (const QTimeZone &ts : zones) {
+        for (QDate date = first.addDays(-3); date <= first.addDays(70); date = date.addDays(1)) {
+            const Event::List events = cal->rawEventsForDate(date, ts, EventSortSummary);
+            Event::List expected;
+            const Event::List all = cal->rawEvents(EventSortSummary);
+            std::copy_if(all.cbegin(), all.cend(), std::back_inserter(expected), [&date, &ts](const Event::Ptr &event) {
+                return occursOn(event, date, ts);
+            });
+            QCOMPARE(events, expected);
+        }
+    }
+
+    // Events moved to another tree are found there.
+    const Event::List all = cal->rawEvents();
+    for (const Event::Ptr &event : all) {
+        event->setDtEnd(event->dtStart().addDays(3));
+    }
+    const QDate date = first.addDays(2);
+    QCOMPARE(cal->rawEventsForDate(date, zones[0]).count(), int(std::count_if(all.cbegin(), all.cend(), [&date, &zones](const Event::Ptr &event) {
+                 return occursOn(event, date, zones[0]);
+             })));
+}
+
 void MemoryCalendarTest::testDeleteIncidence()
 {
     MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
@@ -459,4 +639,656 @@ void MemoryCalendarTest::testUpdateIncidence()
     QCOMPARE(event->lastModified(), dt);
 }
 
+void MemoryCalendarTest::testAlarmSchedule()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    const QDateTime now(QDate(2022, 5, 2), QTime(8, 0), QTimeZone::utc());
+    cal->setAlarmsCheckedUntil(now);
+    QCOMPARE(cal->alarmsCheckedUntil(), now);
+    QVERIFY(!cal->nextAlarmTime().isValid());
+
+    Event::Ptr event(new Event());
+    event->setDtStart(now.addSecs(3600));
+    event->setDtEnd(now.addSecs(7200));
+    Alarm::Ptr alarm = event->newAlarm();
+    alarm->setStartOffset(Duration(-600));
+    alarm->setEnabled(true);
+    QVERIFY(cal->addEvent(event));
+
+    Event::Ptr daily(new Event());
+    daily->setDtStart(now.addSecs(2 * 3600));
+    daily->setDtEnd(now.addSecs(3 * 3600));
+    daily->recurrence()->setDaily(1);
+    Alarm::Ptr dailyAlarm = daily->newAlarm();
+    dailyAlarm->setStartOffset(Duration(-300));
+    dailyAlarm->setEnabled(true);
+    QVERIFY(cal->addEvent(daily));
+
+    Todo::Ptr todo(new Todo());
+    todo->setDtDue(now.addSecs(1800));
+    Alarm::Ptr todoAlarm = todo->newAlarm();
+    todoAlarm->setTime(now.addSecs(1200));
+    todoAlarm->setEnabled(true);
+    QVERIFY(cal->addTodo(todo));
+
+    QCOMPARE(cal->nextAlarmTime(), now.addSecs(1200));
+
+    // Completing the to-do removes its alarm from the schedule.
+    todo->setCompleted(true);
+    QCOMPARE(cal->nextAlarmTime(), now.addSecs(3000));
+
+    // Alarms are returned once, when their time is reached.
+    QVERIFY(cal->alarmsUntil(now.addSecs(2999)).isEmpty());
+    Alarm::List alarms = cal->alarmsUntil(now.addSecs(3000));
+    QCOMPARE(alarms.count(), 1);
+    QVERIFY(alarms.first() == alarm);
+    QCOMPARE(cal->alarmsCheckedUntil(), now.addSecs(3000));
+    QCOMPARE(cal->nextAlarmTime(), now.addSecs(2 * 3600 - 300));
+
+    // Recurring alarms are rescheduled for the next occurrence.
+    alarms = cal->alarmsUntil(now.addSecs(3 * 3600));
+    QCOMPARE(alarms.count(), 1);
+    QVERIFY(alarms.first() == dailyAlarm);
+    QCOMPARE(cal->nextAlarmTime(), now.addDays(1).addSecs(2 * 3600 - 300));
+
+    // Moving the event updates its scheduled alarm.
+    daily->setDtStart(now.addSecs(4 * 3600));
+    daily->setDtEnd(now.addSecs(5 * 3600));
+    QCOMPARE(cal->nextAlarmTime(), now.addSecs(4 * 3600 - 300));
+
+    QVERIFY(cal->deleteIncidence(daily));
+    QVERIFY(!cal->nextAlarmTime().isValid());
+}
+
+void MemoryCalendarTest::testLookupIndexes()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+
+    Todo::Ptr parent(new Todo);
+    parent->setUid(QStringLiteral("parent"));
+    parent->setCategories(QStringList{QStringLiteral("work"), QStringLiteral("urgent")});
+    QVERIFY(cal->addTodo(parent));
+
+    Event::Ptr event(new Event);
+    event->setUid(QStringLiteral("event"));
+    event->setSchedulingID(QStringLiteral("sid"));
+    event->setRelatedTo(parent->uid());
+    event->setCategories(QStringList{QStringLiteral("work")});
+    QVERIFY(cal->addEvent(event));
+
+    Journal::Ptr journal(new Journal);
+    journal->setSchedulingID(QStringLiteral("sid"));
+    journal->setRelatedTo(parent->uid(), Incidence::RelTypeSibling);
+    QVERIFY(cal->addJournal(journal));
+
+    QCOMPARE(cal->incidenceFromSchedulingID(QStringLiteral("sid")), Incidence::Ptr(event));
+    QCOMPARE(cal->incidencesFromSchedulingID(QStringLiteral("sid")).count(), 2);
+    QCOMPARE(cal->incidenceFromSchedulingID(parent->uid()), Incidence::Ptr(parent));
+    QVERIFY(!cal->incidenceFromSchedulingID(QStringLiteral("unknown")));
+    QCOMPARE(cal->relatedIncidences(parent->uid()).count(), 2);
+
+    // Categories are listed in the order they came into use.
+    QCOMPARE(cal->categories(), (QStringList{QStringLiteral("work"), QStringLiteral("urgent")}));
+
+    // Changes are reflected by the indexes.
+    event->setSchedulingID(QStringLiteral("other"));
+    event->setRelatedTo(QString());
+    parent->setCategories(QStringList{QStringLiteral("home")});
+    QCOMPARE(cal->incidenceFromSchedulingID(QStringLiteral("sid")), Incidence::Ptr(journal));
+    QCOMPARE(cal->incidenceFromSchedulingID(QStringLiteral("other")), Incidence::Ptr(event));
+    QCOMPARE(cal->relatedIncidences(parent->uid()), Incidence::List{journal});
+    QCOMPARE(cal->categories(), (QStringList{QStringLiteral("work"), QStringLiteral("home")}));
+
+    QVERIFY(cal->deleteEvent(event));
+    QVERIFY(cal->incidencesFromSchedulingID(QStringLiteral("other")).isEmpty());
+    QCOMPARE(cal->categories(), QStringList{QStringLiteral("home")});
+
+    QVERIFY(cal->deleteJournal(journal));
+    QVERIFY(cal->relatedIncidences(parent->uid()).isEmpty());
+    QVERIFY(cal->incidencesFromSchedulingID(QStringLiteral("sid")).isEmpty());
+}
+
+void MemoryCalendarTest::testRelationHierarchy()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+
+    // root -> a -> (a1, a2), root -> b
+    const auto addTodo = [&cal](const QString &uid, const QString &parent) {
+        Todo::Ptr todo(new Todo);
+        todo->setUid(uid);
+        todo->setRelatedTo(parent);
+        cal->addTodo(todo);
+        return todo;
+    };
+    Todo::Ptr root = addTodo(QStringLiteral("root"), QString());
+    Todo::Ptr a = addTodo(QStringLiteral("a"), root->uid());
+    Todo::Ptr b = addTodo(QStringLiteral("b"), root->uid());
+    Todo::Ptr a1 = addTodo(QStringLiteral("a1"), a->uid());
+    Todo::Ptr a2 = addTodo(QStringLiteral("a2"), a->uid());
+
+    const auto uids = [](const Incidence::List &incidences) {
+        QStringList list;
+        for (const auto &incidence : incidences) {
+            list.append(incidence->uid());
+        }
+        return list;
+    };
+    const auto sorted = [](QStringList list) {
+        list.sort();
+        return list;
+    };
+
+    QCOMPARE(sorted(uids(cal->childIncidences(root->uid()))), (QStringList{QStringLiteral("a"), QStringLiteral("b")}));
+    QCOMPARE(sorted(uids(cal->childIncidences(a->uid()))), (QStringList{QStringLiteral("a1"), QStringLiteral("a2")}));
+    QVERIFY(cal->childIncidences(b->uid()).isEmpty());
+    QCOMPARE(uids(cal->ancestors(a2->uid())), (QStringList{QStringLiteral("a"), QStringLiteral("root")}));
+    QVERIFY(cal->ancestors(root->uid()).isEmpty());
+
+    // Descendants are listed depth first.
+    const QStringList descendants = uids(cal->descendants(root->uid()));
+    QCOMPARE(sorted(descendants), (QStringList{QStringLiteral("a"), QStringLiteral("a1"), QStringLiteral("a2"), QStringLiteral("b")}));
+    QVERIFY(descendants.indexOf(QStringLiteral("a1")) > descendants.indexOf(QStringLiteral("a")));
+    QVERIFY(descendants.indexOf(QStringLiteral("a2")) > descendants.indexOf(QStringLiteral("a")));
+    QVERIFY(!cal->hasRelationCycle(a2->uid()));
+
+    // Moving a subtree.
+    a->setRelatedTo(b->uid());
+    QCOMPARE(uids(cal->childIncidences(root->uid())), QStringList{QStringLiteral("b")});
+    QCOMPARE(uids(cal->ancestors(a1->uid())), (QStringList{QStringLiteral("a"), QStringLiteral("b"), QStringLiteral("root")}));
+
+    // Cycles are detected and do not loop.
+    root->setRelatedTo(a1->uid());
+    QVERIFY(cal->hasRelationCycle(a2->uid()));
+    QVERIFY(cal->hasRelationCycle(root->uid()));
+    QCOMPARE(uids(cal->ancestors(a1->uid())), (QStringList{QStringLiteral("a"), QStringLiteral("b"), QStringLiteral("root")}));
+    QCOMPARE(cal->descendants(root->uid()).count(), 4);
+    root->setRelatedTo(QString());
+    QVERIFY(!cal->hasRelationCycle(a2->uid()));
+
+    // Removing a parent leaves its children in place.
+    QVERIFY(cal->deleteTodo(b));
+    QVERIFY(cal->descendants(root->uid()).isEmpty());
+    QCOMPARE(uids(cal->ancestors(a1->uid())), QStringList{QStringLiteral("a")});
+    QCOMPARE(cal->descendants(a->uid()).count(), 2);
+}
+
+static QStringList sortedUids(const Incidence::List &incidences)
+{
+    QStringList uids;
+    for (const Incidence::Ptr &incidence : incidences) {
+        uids << incidence->uid();
+    }
+    uids.sort();
+    return uids;
+}
+
+// Filtered queries only check the incidences found in the indexes, which must
+// give the same results as filtering all of them.
+void MemoryCalendarTest::testFilterIndexes()
+{
+    CalFilter filter;
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    cal->setFilter(&filter);
+
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    const QStringList categories[] = {{QStringLiteral("work")}, {QStringLiteral("home"), QStringLiteral("work")}, {QStringLiteral("home")}, {}};
+    for (int i = 0; i < 40; ++i) {
+        Todo::Ptr todo(new Todo);
+        todo->setUid(QStringLiteral("todo%1").arg(i));
+        todo->setDtStart(now.addDays(i % 3 - 1));
+        todo->setCategories(categories[i % 4]);
+        if (i % 5 == 0) {
+            todo->setCompleted(now.addDays(-i));
+        }
+        if (i % 3 == 0) {
+            todo->addAttendee(Attendee(QStringLiteral("Me"), QStringLiteral("me@example.com")));
+        } else if (i % 3 == 1) {
+            todo->addAttendee(Attendee(QStringLiteral("Other"), QStringLiteral("other@example.com")));
+        }
+        QVERIFY(cal->addTodo(todo));
+
+        Event::Ptr event(new Event);
+        event->setUid(QStringLiteral("event%1").arg(i));
+        event->setDtStart(now.addDays(i));
+        event->setCategories(categories[(i + 1) % 4]);
+        QVERIFY(cal->addEvent(event));
+    }
+
+    const auto check = [&cal, &filter]() {
+        Incidence::List todos;
+        Incidence::List events;
+        const Todo::List rawTodos = cal->rawTodos();
+        const Event::List rawEvents = cal->rawEvents();
+        std::copy_if(rawTodos.cbegin(), rawTodos.cend(), std::back_inserter(todos), [&filter](const Todo::Ptr &todo) {
+            return filter.filterIncidence(todo);
+        });
+        std::copy_if(rawEvents.cbegin(), rawEvents.cend(), std::back_inserter(events), [&filter](const Event::Ptr &event) {
+            return filter.filterIncidence(event);
+        });
+        const Todo::List filteredTodos = cal->todos();
+        const Event::List filteredEvents = cal->events();
+        QCOMPARE(sortedUids(Incidence::List(filteredTodos.cbegin(), filteredTodos.cend())), sortedUids(todos));
+        QCOMPARE(sortedUids(Incidence::List(filteredEvents.cbegin(), filteredEvents.cend())), sortedUids(events));
+    };
+
+    const int criteria[] = {CalFilter::ShowCategories,
+                            CalFilter::HideCompletedTodos,
+                            CalFilter::HideInactiveTodos,
+                            CalFilter::HideNoMatchingAttendeeTodos,
+                            CalFilter::ShowCategories | CalFilter::HideCompletedTodos | CalFilter::HideNoMatchingAttendeeTodos};
+    filter.setCategoryList(QStringList{QStringLiteral("home")});
+    filter.setEmailList(QStringList{QStringLiteral("me@example.com")});
+    filter.setCompletedTimeSpan(12);
+    for (int c : criteria) {
+        filter.setCriteria(c);
+        check();
+    }
+
+    // Changes are reflected by the indexes.
+    filter.setCriteria(CalFilter::ShowCategories | CalFilter::HideCompletedTodos);
+    const Todo::Ptr todo = cal->todo(QStringLiteral("todo1"));
+    todo->setCompleted(now.addDays(-30));
+    QVERIFY(!cal->todos().contains(todo));
+    todo->setCompleted(false);
+    todo->setCategories(QStringList{QStringLiteral("work")});
+    QVERIFY(!cal->todos().contains(todo));
+    todo->setCategories(QStringList{QStringLiteral("home")});
+    QVERIFY(cal->todos().contains(todo));
+    check();
+
+    filter.setEnabled(false);
+    QCOMPARE(cal->todos().count(), 40);
+    cal->setFilter(nullptr);
+}
+
+void MemoryCalendarTest::testExpandOccurrences()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    const QTimeZone berlin("Europe/Berlin");
+    const QDateTime start(QDate(2024, 1, 1), QTime(0, 0), berlin);
+    const QDateTime end(QDate(2024, 3, 31), QTime(23, 59, 59), berlin);
+
+    for (int i = 0; i < 200; ++i) {
+        Event::Ptr event(new Event);
+        event->setDtStart(QDateTime(QDate(2023, 12, 1).addDays(i), QTime(i % 24, 0), berlin));
+        event->setDtEnd(event->dtStart().addSecs(1800 * (i % 5)));
+        if (i % 3 == 0) {
+            event->recurrence()->setDaily(i % 7 + 1);
+        }
+        QVERIFY(cal->addEvent(event));
+    }
+    Event::Ptr allDay(new Event);
+    allDay->setDtStart(QDateTime(QDate(2024, 2, 1), QTime(0, 0), berlin));
+    allDay->setDtEnd(QDateTime(QDate(2024, 2, 2), QTime(0, 0), berlin));
+    allDay->setAllDay(true);
+    QVERIFY(cal->addEvent(allDay));
+    Todo::Ptr todo(new Todo);
+    todo->setDtStart(QDateTime(QDate(2024, 1, 10), QTime(9, 0), berlin));
+    todo->setDtDue(QDateTime(QDate(2024, 1, 10), QTime(10, 0), berlin));
+    todo->recurrence()->setWeekly(1);
+    QVERIFY(cal->addTodo(todo));
+
+    const Calendar::OccurrenceArrays occurrences = cal->expandOccurrences(start, end);
+    QCOMPARE(occurrences.incidences.count(), 202);
+    QCOMPARE(occurrences.durations.count(), occurrences.starts.count());
+    QCOMPARE(occurrences.incidenceIndexes.count(), occurrences.starts.count());
+
+    int i = 0;
+    for (int index = 0; index < occurrences.incidences.count(); ++index) {
+        const Incidence::Ptr incidence = occurrences.incidences.at(index);
+        QList<QDateTime> expected;
+        if (incidence->recurs()) {
+            expected = incidence->recurrence()->timesInInterval(start, end);
+        } else if (incidence->dtStart() >= start && incidence->dtStart() <= end) {
+            expected.append(incidence->dtStart());
+        }
+        qint64 duration = incidence->dtStart().secsTo(incidence->dateTime(Incidence::RoleEnd));
+        if (incidence == allDay) {
+            duration = 2 * 86400;
+        }
+        for (const QDateTime &dt : std::as_const(expected)) {
+            QCOMPARE(occurrences.incidenceIndexes.at(i), index);
+            QCOMPARE(occurrences.starts.at(i), dt.toSecsSinceEpoch());
+            QCOMPARE(occurrences.durations.at(i), duration);
+            ++i;
+        }
+    }
+    QCOMPARE(i, occurrences.starts.count());
+
+    // Threads give the same result.
+    const Calendar::OccurrenceArrays threaded = cal->expandOccurrences(start, end, occurrences.incidences, 4);
+    QCOMPARE(threaded.starts, occurrences.starts);
+    QCOMPARE(threaded.durations, occurrences.durations);
+    QCOMPARE(threaded.incidenceIndexes, occurrences.incidenceIndexes);
+
+    // A subset only expands the incidences given.
+    const Calendar::OccurrenceArrays subset = cal->expandOccurrences(start, end, Incidence::List{todo});
+    QCOMPARE(subset.starts.count(), todo->recurrence()->timesInInterval(start, end).count());
+    QCOMPARE(subset.durations.first(), qint64(3600));
+
+    // A to-do without a start date occurs at its due date.
+    Todo::Ptr dueOnly(new Todo);
+    dueOnly->setDtDue(QDateTime(QDate(2024, 2, 20), QTime(17, 0), berlin));
+    const Calendar::OccurrenceArrays due = cal->expandOccurrences(start, end, Incidence::List{dueOnly});
+    QCOMPARE(due.starts, QList<qint64>{dueOnly->dtDue().toSecsSinceEpoch()});
+    QCOMPARE(due.durations, QList<qint64>{0});
+    QCOMPARE(due.incidenceIndexes, QList<int>{0});
+}
+
+template<typename List, typename LessThan>
+static bool isSortedBy(const List &list, LessThan lessThan)
+{
+    for (qsizetype i = 1; i < list.size(); ++i) {
+        if (lessThan(list.at(i), list.at(i - 1))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The sort functions compare precomputed keys, which must order the lists as
+// the comparison functions of sorting.h do.
+void MemoryCalendarTest::testSortKeys()
+{
+    const QTimeZone berlin("Europe/Berlin");
+    const QStringList summaries = {QStringLiteral("beta"),
+                                   QStringLiteral("Alpha"),
+                                   QStringLiteral("alpha"),
+                                   QStringLiteral("Ärger"),
+                                   QStringLiteral("zeta"),
+                                   QString(),
+                                   QStringLiteral("BETA")};
+    const QDate date(2024, 3, 29);
+
+    Event::List events;
+    Todo::List todos;
+    Journal::List journals;
+    for (int i = 0; i < 60; ++i) {
+        const QString summary = summaries.at(i % summaries.size());
+        // Times of day are never midnight, so no date/time starts with an all-day date.
+        const QDateTime dt(date.addDays(i % 5), QTime(1 + i % 4, 30), i % 2 ? berlin : QTimeZone::utc());
+
+        Event::Ptr event(new Event);
+        event->setSummary(summary);
+        if (i % 6 == 0) {
+            event->setDtStart(QDateTime(date.addDays(i % 4), {}));
+            event->setDtEnd(event->dtStart());
+            event->setAllDay(true);
+        } else {
+            event->setDtStart(dt);
+            event->setDtEnd(dt.addSecs(3600 * (i % 3)));
+        }
+        events << event;
+
+        Todo::Ptr todo(new Todo);
+        todo->setSummary(summary);
+        todo->setPriority(i % 4);
+        todo->setPercentComplete(10 * (i % 3));
+        todo->setCategories(QStringList{summaries.at(i % 3)});
+        if (i % 3) {
+            todo->setDtStart(dt);
+        }
+        if (i % 4) {
+            todo->setDtDue(dt.addDays(1));
+        }
+        todos << todo;
+
+        Journal::Ptr journal(new Journal);
+        journal->setSummary(summary);
+        journal->setDtStart(QDateTime(date, QTime(12, 0), QTimeZone::utc()).addSecs(-3600 * i));
+        journals << journal;
+    }
+
+    const auto sortedEvents = [&events](EventSortField field, SortDirection direction) {
+        return Calendar::sortEvents(Event::List(events), field, direction);
+    };
+    QVERIFY(isSortedBy(sortedEvents(EventSortStartDate, SortDirectionAscending), Events::startDateLessThan));
+    QVERIFY(isSortedBy(sortedEvents(EventSortStartDate, SortDirectionDescending), Events::startDateMoreThan));
+    QVERIFY(isSortedBy(sortedEvents(EventSortEndDate, SortDirectionAscending), Events::endDateLessThan));
+    QVERIFY(isSortedBy(sortedEvents(EventSortEndDate, SortDirectionDescending), Events::endDateMoreThan));
+    QVERIFY(isSortedBy(sortedEvents(EventSortSummary, SortDirectionAscending), Events::summaryLessThan));
+    QVERIFY(isSortedBy(sortedEvents(EventSortSummary, SortDirectionDescending), Events::summaryMoreThan));
+    QCOMPARE(sortedEvents(EventSortStartDate, SortDirectionAscending).count(), events.count());
+
+    const auto sortedTodos = [&todos](TodoSortField field, SortDirection direction) {
+        return Calendar::sortTodos(Todo::List(todos), field, direction);
+    };
+    QVERIFY(isSortedBy(sortedTodos(TodoSortStartDate, SortDirectionAscending), Todos::startDateLessThan));
+    QVERIFY(isSortedBy(sortedTodos(TodoSortStartDate, SortDirectionDescending), Todos::startDateMoreThan));
+    QVERIFY(isSortedBy(sortedTodos(TodoSortDueDate, SortDirectionAscending), Todos::dueDateLessThan));
+    QVERIFY(isSortedBy(sortedTodos(TodoSortDueDate, SortDirectionDescending), Todos::dueDateMoreThan));
+    QVERIFY(isSortedBy(sortedTodos(TodoSortPriority, SortDirectionAscending), Todos::priorityLessThan));
+    QVERIFY(isSortedBy(sortedTodos(TodoSortPriority, SortDirectionDescending), Todos::priorityMoreThan));
+    QVERIFY(isSortedBy(sortedTodos(TodoSortPercentComplete, SortDirectionAscending), Todos::percentLessThan));
+    QVERIFY(isSortedBy(sortedTodos(TodoSortPercentComplete, SortDirectionDescending), Todos::percentMoreThan));
+    QVERIFY(isSortedBy(sortedTodos(TodoSortSummary, SortDirectionAscending), Todos::summaryLessThan));
+    QVERIFY(isSortedBy(sortedTodos(TodoSortSummary, SortDirectionDescending), Todos::summaryMoreThan));
+    QVERIFY(isSortedBy(sortedTodos(TodoSortCreated, SortDirectionAscending), Todos::createdLessThan));
+    QVERIFY(isSortedBy(sortedTodos(TodoSortCreated, SortDirectionDescending), Todos::createdMoreThan));
+    QVERIFY(isSortedBy(sortedTodos(TodoSortCategories, SortDirectionAscending), Incidences::categoriesLessThan));
+    QVERIFY(isSortedBy(sortedTodos(TodoSortCategories, SortDirectionDescending), Incidences::categoriesMoreThan));
+    QCOMPARE(sortedTodos(TodoSortDueDate, SortDirectionAscending).count(), todos.count());
+
+    QVERIFY(isSortedBy(Calendar::sortJournals(Journal::List(journals), JournalSortDate, SortDirectionAscending), Journals::dateLessThan));
+    QVERIFY(isSortedBy(Calendar::sortJournals(Journal::List(journals), JournalSortDate, SortDirectionDescending), Journals::dateMoreThan));
+    QVERIFY(isSortedBy(Calendar::sortJournals(Journal::List(journals), JournalSortSummary, SortDirectionAscending), Journals::summaryLessThan));
+    QVERIFY(isSortedBy(Calendar::sortJournals(Journal::List(journals), JournalSortSummary, SortDirectionDescending), Journals::summaryMoreThan));
+
+    // Long lists are sorted in parallel.
+    Event::List manyEvents;
+    for (int i = 0; i < 20000; ++i) {
+        Event::Ptr event(new Event);
+        event->setSummary(summaries.at(i % summaries.size()));
+        event->setDtStart(QDateTime(date, QTime(1, 17), QTimeZone::utc()).addSecs(600 * ((i * 7919) % 5003)));
+        manyEvents << event;
+    }
+    const Event::List manySorted = Calendar::sortEvents(Event::List(manyEvents), EventSortStartDate, SortDirectionAscending);
+    QVERIFY(isSortedBy(manySorted, Events::startDateLessThan));
+    QCOMPARE(manySorted.count(), manyEvents.count());
+    QVERIFY(isSortedBy(Calendar::sortEvents(Event::List(manyEvents), EventSortSummary, SortDirectionDescending), Events::summaryMoreThan));
+}
+
+// Incidence lists merged from the lists of each type, and the incidences of
+// the calendar, come ordered as Incidences::dateLessThan() orders them.
+void MemoryCalendarTest::testOrderedIncidences()
+{
+    const QTimeZone berlin("Europe/Berlin");
+    const QStringList summaries = {QStringLiteral("beta"), QStringLiteral("Alpha"), QString(), QStringLiteral("zeta")};
+    const QDate date(2024, 3, 29);
+
+    // Timed incidences never start at midnight, which Incidences::dateLessThan()
+    // doesn't order against an all-day incidence on the same date.
+    Event::List events;
+    Todo::List todos;
+    Journal::List journals;
+    for (int i = 0; i < 40; ++i) {
+        const QString summary = summaries.at(i % summaries.size());
+        const QDateTime dt(date.addDays(i % 3), QTime(1 + i % 5, 15), i % 2 ? berlin : QTimeZone::utc());
+
+        Event::Ptr event(new Event);
+        event->setSummary(summary);
+        if (i % 6 == 0) {
+            event->setDtStart(QDateTime(date.addDays(i % 4), {}));
+            event->setDtEnd(event->dtStart());
+            event->setAllDay(true);
+        } else {
+            event->setDtStart(dt);
+            event->setDtEnd(dt.addSecs(3600));
+        }
+        events << event;
+
+        Todo::Ptr todo(new Todo);
+        todo->setSummary(summary);
+        if (i % 3) {
+            todo->setDtStart(dt);
+        }
+        if (i % 4) {
+            todo->setDtDue(dt.addDays(1));
+        }
+        todos << todo;
+
+        Journal::Ptr journal(new Journal);
+        journal->setSummary(summary);
+        journal->setDtStart(QDateTime(date, QTime(12, 17), QTimeZone::utc()).addSecs(-3600 * i));
+        journals << journal;
+    }
+
+    const Event::List sortedEvents = Calendar::sortEvents(Event::List(events), EventSortStartDate, SortDirectionAscending);
+    const Incidence::List merged = Calendar::mergeIncidenceList(sortedEvents, todos, journals, SortDirectionAscending);
+    QVERIFY(isSortedBy(merged, Incidences::dateLessThan));
+    QCOMPARE(merged.count(), events.count() + todos.count() + journals.count());
+    QVERIFY(isSortedBy(Calendar::mergeIncidenceList(events, todos, journals, SortDirectionDescending), Incidences::dateMoreThan));
+    QVERIFY(isSortedBy(Calendar::mergeIncidenceList(events, {}, {}, SortDirectionAscending), Incidences::dateLessThan));
+    QVERIFY(Calendar::mergeIncidenceList({}, {}, {}, SortDirectionAscending).isEmpty());
+
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    for (const auto &event : std::as_const(events)) {
+        cal->addEvent(event);
+    }
+    for (const auto &todo : std::as_const(todos)) {
+        cal->addTodo(todo);
+    }
+    for (const auto &journal : std::as_const(journals)) {
+        cal->addJournal(journal);
+    }
+    QCOMPARE(cal->rawIncidences().count(), merged.count());
+    QVERIFY(isSortedBy(cal->rawIncidences(), Incidences::dateLessThan));
+    QCOMPARE(cal->incidences().count(), merged.count());
+    QVERIFY(isSortedBy(cal->incidences(), Incidences::dateLessThan));
+    QVERIFY(!cal->incidences(date).isEmpty());
+    QVERIFY(isSortedBy(cal->incidences(date), Incidences::dateLessThan));
+
+    // The ordered list follows changes to the calendar.
+    events.at(2)->setDtEnd(QDateTime(date.addDays(10), QTime(10, 45), berlin));
+    events.at(2)->setDtStart(QDateTime(date.addDays(10), QTime(9, 45), berlin));
+    QCOMPARE(cal->rawIncidences().constLast(), events.at(2));
+    QVERIFY(isSortedBy(cal->rawIncidences(), Incidences::dateLessThan));
+    QVERIFY(cal->deleteJournal(journals.constLast()));
+    QCOMPARE(cal->rawIncidences().count(), merged.count() - 1);
+    QVERIFY(!cal->rawIncidences().contains(journals.constLast()));
+
+    // Filtered incidences keep the order.
+    CalFilter filter;
+    filter.setCriteria(CalFilter::ShowCategories);
+    filter.setCategoryList({QStringLiteral("none")});
+    filter.setEnabled(true);
+    events.at(1)->setCategories({QStringLiteral("none")});
+    cal->setFilter(&filter);
+    QCOMPARE(cal->incidences().count(), 1);
+    QCOMPARE(cal->incidences().constFirst(), events.at(1));
+    cal->setFilter(nullptr);
+    QCOMPARE(cal->incidences().count(), merged.count() - 1);
+}
+
+void MemoryCalendarTest::testSnapshot()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    const QDateTime dt(QDate(2024, 5, 6), QTime(10, 0), QTimeZone::utc());
+
+    Event::Ptr event(new Event);
+    event->setDtStart(dt);
+    event->setDtEnd(dt.addSecs(3600));
+    QVERIFY(cal->addEvent(event));
+
+    const MemoryCalendar::Snapshot empty;
+    QVERIFY(empty.rawEvents().isEmpty());
+    QVERIFY(!empty.incidence(event->uid()));
+
+    const MemoryCalendar::Snapshot before = cal->snapshot();
+    QCOMPARE(before.timeZone(), QTimeZone::utc());
+    QCOMPARE(before.rawEvents().count(), 1);
+    QCOMPARE(before.incidence(event->uid()), event);
+    QCOMPARE(before.instance(event->instanceIdentifier()), event);
+    QCOMPARE(before.rawEventsForDate(dt.date()).count(), 1);
+    QCOMPARE(before.rawEvents(dt.date(), dt.date()).count(), 1);
+
+    Event::Ptr recurring(new Event);
+    recurring->setDtStart(dt.addDays(1));
+    recurring->setDtEnd(dt.addDays(1).addSecs(3600));
+    recurring->recurrence()->setDaily(1);
+    QVERIFY(cal->addEvent(recurring));
+    Todo::Ptr todo(new Todo);
+    todo->setDtDue(dt);
+    QVERIFY(cal->addTodo(todo));
+    QVERIFY(cal->deleteEvent(event));
+
+    // The earlier snapshot does not see the changes...
+    QCOMPARE(before.rawEvents().count(), 1);
+    QCOMPARE(before.incidence(event->uid()), event);
+    QVERIFY(!before.incidence(recurring->uid()));
+    QVERIFY(before.rawEventsForDate(dt.date().addDays(3)).isEmpty());
+    QCOMPARE(before.rawEvents(dt.date(), dt.date().addDays(3)).count(), 1);
+    QVERIFY(before.rawTodos().isEmpty());
+
+    // ... a new one does.
+    const MemoryCalendar::Snapshot after = cal->snapshot();
+    QCOMPARE(after.rawEvents().count(), 1);
+    QVERIFY(!after.incidence(event->uid()));
+    QCOMPARE(after.incidence(recurring->uid()), recurring);
+    QCOMPARE(after.incidence(todo->uid()), todo);
+    QCOMPARE(after.rawEventsForDate(dt.date().addDays(3)).count(), 1);
+    QCOMPARE(after.rawEvents(dt.date(), dt.date().addDays(3)).count(), 1);
+    QCOMPARE(after.rawTodos().count(), 1);
+    QVERIFY(after.rawJournals().isEmpty());
+
+    // Without changes in between, snapshots are the same.
+    const MemoryCalendar::Snapshot again = cal->snapshot();
+    QCOMPARE(again.rawEvents(), after.rawEvents());
+
+    cal->setTimeZone(QTimeZone("Europe/Berlin"));
+    QCOMPARE(after.timeZone(), QTimeZone::utc());
+    QCOMPARE(cal->snapshot().timeZone(), QTimeZone("Europe/Berlin"));
+}
+
+void MemoryCalendarTest::testConcurrentSnapshotReads()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    const QDate firstDate(2024, 1, 1);
+    const int count = 2000;
+
+    // Each reader checks that every snapshot it takes is consistent: all the
+    // events it contains can be found by uid and by date.
+    std::atomic<bool> done(false);
+    std::atomic<int> failures(0);
+    std::vector<std::unique_ptr<QThread>> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back(QThread::create([&]() {
+            while (!done) {
+                const MemoryCalendar::Snapshot snapshot = cal->snapshot();
+                const Event::List events = snapshot.rawEvents();
+                for (const Event::Ptr &event : events) {
+                    if (snapshot.incidence(event->uid()) != event || !snapshot.rawEventsForDate(event->dtStart().date()).contains(event)) {
+                        ++failures;
+                    }
+                }
+            }
+        }));
+        readers.back()->start();
+    }
+
+    Event::List added;
+    for (int i = 0; i < count; ++i) {
+        Event::Ptr event(new Event);
+        const QDateTime start(firstDate.addDays(i % 100), QTime(i % 24, 0), QTimeZone::utc());
+        event->setDtStart(start);
+        event->setDtEnd(start.addSecs(1800));
+        if (i % 10 == 0) {
+            event->recurrence()->setWeekly(1);
+            event->recurrence()->setDuration(10);
+        }
+        QVERIFY(cal->addEvent(event));
+        added.append(event);
+        if (i % 3 == 0) {
+            QVERIFY(cal->deleteEvent(added.takeFirst()));
+        }
+    }
+
+    done = true;
+    for (const auto &reader : readers) {
+        reader->wait();
+    }
+    QCOMPARE(failures.load(), 0);
+    QCOMPARE(cal->snapshot().rawEvents().count(), added.count());
+}
+
 #include "moc_testmemorycalendar.cpp"
@@ -24,8 +24,20 @@ private Q_SLOTS:
     void testChangeRecurId();
     void testRawEvents();
     void testRawEventsForDate();
+    void testRawEventsIndexUpdate();
+    void testRecurringEventsForDate();
+    void testEventsForDateInOtherTimeZone();
     void testDeleteIncidence();
     void testUpdateIncidence();
+    void testAlarmSchedule();
+    void testLookupIndexes();
+    void testRelationHierarchy();
+    void testFilterIndexes();
+    void testExpandOccurrences();
+    void testSortKeys();
+    void testOrderedIncidences();
+    void testSnapshot();
+    void testConcurrentSnapshotReads();
 };
 
 #endif
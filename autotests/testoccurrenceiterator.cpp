@@ -13,6 +13,8 @@
 #include <QTest>
 #include <QTimeZone>
 
+#include <algorithm>
+
 QTEST_MAIN(TestOccurrenceIterator)
 
 void TestOccurrenceIterator::testIterationWithExceptions()
@@ -322,4 +324,70 @@ void TestOccurrenceIterator::testEndDate()
     QVERIFY(!rIt.hasNext());
 }
 
+void TestOccurrenceIterator::testChronological()
+{
+    KCalendarCore::MemoryCalendar calendar(QTimeZone::utc());
+
+    const QDateTime start(QDate(2013, 03, 10), QTime(10, 0, 0), Qt::UTC);
+    const QDateTime actualEnd(QDate(2013, 03, 20), QTime(23, 0, 0), Qt::UTC);
+
+    KCalendarCore::Event::Ptr daily(new KCalendarCore::Event());
+    daily->setUid(QStringLiteral("daily"));
+    daily->setDtStart(start);
+    daily->setDtEnd(start.addSecs(3600));
+    daily->recurrence()->setDaily(1);
+    calendar.addEvent(daily);
+
+    // Moved after the next occurrences of the other series.
+    KCalendarCore::Event::Ptr exception(new KCalendarCore::Event());
+    exception->setUid(daily->uid());
+    exception->setRecurrenceId(start.addDays(2));
+    exception->setDtStart(start.addDays(2).addSecs(10 * 3600));
+    exception->setDtEnd(start.addDays(2).addSecs(11 * 3600));
+    calendar.addEvent(exception);
+
+    KCalendarCore::Event::Ptr everyOtherDay(new KCalendarCore::Event());
+    everyOtherDay->setUid(QStringLiteral("everyOtherDay"));
+    everyOtherDay->setDtStart(start.addSecs(2 * 3600));
+    everyOtherDay->recurrence()->setDaily(2);
+    calendar.addEvent(everyOtherDay);
+
+    KCalendarCore::Event::Ptr single(new KCalendarCore::Event());
+    single->setUid(QStringLiteral("single"));
+    single->setDtStart(start.addDays(3).addSecs(-3600));
+    calendar.addEvent(single);
+
+    QList<QDateTime> expected;
+    KCalendarCore::OccurrenceIterator expandedIt(calendar, start, actualEnd);
+    while (expandedIt.hasNext()) {
+        expandedIt.next();
+        expected << expandedIt.occurrenceStartDate();
+    }
+    std::sort(expected.begin(), expected.end());
+
+    QList<QDateTime> starts;
+    KCalendarCore::OccurrenceIterator rIt(calendar, start, actualEnd, KCalendarCore::OccurrenceIterator::Mode::Chronological);
+    while (rIt.hasNext()) {
+        rIt.next();
+        starts << rIt.occurrenceStartDate();
+        if (rIt.occurrenceStartDate() == exception->dtStart()) {
+            QVERIFY(rIt.incidence() == exception);
+            QCOMPARE(rIt.recurrenceId(), exception->recurrenceId());
+        }
+    }
+    QCOMPARE(starts, expected);
+    QVERIFY(starts.contains(exception->dtStart()));
+    QVERIFY(!starts.contains(exception->recurrenceId()));
+
+    // Reading the first occurrences of an open-ended range.
+    KCalendarCore::OccurrenceIterator longIt(calendar, start, start.addYears(10), KCalendarCore::OccurrenceIterator::Mode::Chronological);
+    QVERIFY(longIt.hasNext());
+    longIt.next();
+    QCOMPARE(longIt.occurrenceStartDate(), start);
+    QVERIFY(longIt.incidence() == daily);
+    QVERIFY(longIt.hasNext());
+    longIt.next();
+    QCOMPARE(longIt.occurrenceStartDate(), everyOtherDay->dtStart());
+}
+
 #include "moc_testoccurrenceiterator.cpp"
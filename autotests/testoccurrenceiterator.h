@@ -20,6 +20,7 @@ private Q_SLOTS:
     void testSubDailyRecurrences();
     void testJournals();
     void testEndDate();
+    void testChronological();
 };
 
 #endif // TESTOCCURRENCEITERATOR_H
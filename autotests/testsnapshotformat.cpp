@@ -0,0 +1,138 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "testsnapshotformat.h"
+#include "event.h"
+#include "filestorage.h"
+#include "journal.h"
+#include "memorycalendar.h"
+#include "snapshotformat.h"
+#include "todo.h"
+
+#include <QTemporaryFile>
+#include <QTest>
+#include <QTimeZone>
+
+QTEST_MAIN(SnapshotFormatTest)
+
+using namespace KCalendarCore;
+
+static MemoryCalendar::Ptr createCalendar()
+{
+    auto calendar = MemoryCalendar::Ptr::create(QTimeZone::utc());
+    calendar->setNonKDECustomProperty("X-CALENDAR-PROPERTY", QStringLiteral("value"));
+
+    auto event = Event::Ptr::create();
+    event->setUid(QStringLiteral("event"));
+    event->setSummary(QStringLiteral("Event"));
+    event->setDtStart(QDateTime(QDate(2023, 3, 1), QTime(10, 0), QTimeZone("Europe/Paris")));
+    event->setDtEnd(QDateTime(QDate(2023, 3, 1), QTime(11, 0), QTimeZone("Europe/Paris")));
+    event->setCategories({QStringLiteral("Work")});
+    event->recurrence()->setWeekly(1);
+    event->recurrence()->addExDate(QDate(2023, 3, 8));
+    Alarm::Ptr alarm = event->newAlarm();
+    alarm->setStartOffset(Duration(-600));
+    alarm->setEnabled(true);
+    calendar->addEvent(event);
+
+    auto exception = Event::Ptr(event->clone());
+    exception->clearRecurrence();
+    exception->setRecurrenceId(QDateTime(QDate(2023, 3, 15), QTime(10, 0), QTimeZone("Europe/Paris")));
+    exception->setSummary(QStringLiteral("Moved event"));
+    calendar->addEvent(exception);
+
+    auto todo = Todo::Ptr::create();
+    todo->setUid(QStringLiteral("todo"));
+    todo->setSummary(QStringLiteral("Todo"));
+    todo->setDtDue(QDateTime(QDate(2023, 3, 2), QTime(12, 0), QTimeZone::utc()));
+    todo->setPercentComplete(50);
+    calendar->addTodo(todo);
+
+    auto journal = Journal::Ptr::create();
+    journal->setUid(QStringLiteral("journal"));
+    journal->setDtStart(QDateTime(QDate(2023, 3, 3), QTime(0, 0)));
+    journal->setAllDay(true);
+    journal->setDescription(QStringLiteral("Journal"));
+    calendar->addJournal(journal);
+
+    return calendar;
+}
+
+static void compareCalendars(const MemoryCalendar::Ptr &expected, const MemoryCalendar::Ptr &calendar)
+{
+    QCOMPARE(calendar->incidences().count(), expected->incidences().count());
+    const Incidence::List incidences = expected->incidences();
+    for (const Incidence::Ptr &incidence : incidences) {
+        const Incidence::Ptr loaded = calendar->incidence(incidence->uid(), incidence->recurrenceId());
+        QVERIFY(loaded);
+        QVERIFY(*loaded == *incidence);
+    }
+    QCOMPARE(calendar->nonKDECustomProperty("X-CALENDAR-PROPERTY"), QStringLiteral("value"));
+}
+
+void SnapshotFormatTest::testRoundTrip()
+{
+    const auto expected = createCalendar();
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.close();
+
+    SnapshotFormat format;
+    QVERIFY(format.save(expected, file.fileName()));
+
+    auto calendar = MemoryCalendar::Ptr::create(QTimeZone::utc());
+    QVERIFY(format.load(calendar, file.fileName()));
+    QVERIFY(!format.exception());
+    QCOMPARE(format.loadedProductId(), CalFormat::productId());
+    compareCalendars(expected, calendar);
+
+    // Usable through FileStorage.
+    auto storedCalendar = MemoryCalendar::Ptr::create(QTimeZone::utc());
+    FileStorage storage(storedCalendar, file.fileName(), new SnapshotFormat);
+    QVERIFY(storage.load());
+    compareCalendars(expected, storedCalendar);
+}
+
+void SnapshotFormatTest::testString()
+{
+    const auto expected = createCalendar();
+    SnapshotFormat format;
+
+    auto calendar = MemoryCalendar::Ptr::create(QTimeZone::utc());
+    QVERIFY(format.fromString(calendar, format.toString(expected)));
+    compareCalendars(expected, calendar);
+
+    auto rawCalendar = MemoryCalendar::Ptr::create(QTimeZone::utc());
+    QVERIFY(format.fromRawString(rawCalendar, format.toRawString(expected)));
+    compareCalendars(expected, rawCalendar);
+}
+
+void SnapshotFormatTest::testInvalid()
+{
+    const auto expected = createCalendar();
+    SnapshotFormat format;
+
+    auto calendar = MemoryCalendar::Ptr::create(QTimeZone::utc());
+    QVERIFY(!format.fromRawString(calendar, QByteArray("BEGIN:VCALENDAR\r\nEND:VCALENDAR\r\n")));
+    QVERIFY(format.exception());
+    QCOMPARE(format.exception()->code(), Exception::ParseErrorKcal);
+
+    const QByteArray data = format.toRawString(expected);
+    QVERIFY(!format.fromRawString(calendar, data.left(data.size() - 10)));
+    QVERIFY(format.exception());
+
+    // Snapshots of another layout version are rejected.
+    QByteArray otherVersion = data;
+    otherVersion[7] = 1;
+    QVERIFY(!format.fromRawString(calendar, otherVersion));
+    QVERIFY(format.exception());
+    QCOMPARE(format.exception()->code(), Exception::CalVersionUnknown);
+}
+
+#include "moc_testsnapshotformat.cpp"
@@ -0,0 +1,23 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef TESTSNAPSHOTFORMAT_H
+#define TESTSNAPSHOTFORMAT_H
+
+#include <QObject>
+
+class SnapshotFormatTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testRoundTrip();
+    void testString();
+    void testInvalid();
+};
+
+#endif
@@ -8,10 +8,12 @@
 */
 #include "testtimesininterval.h"
 #include "event.h"
+#include "icalformat.h"
 
 #include <QDebug>
 
 #include <QTest>
+#include <QTimeZone>
 QTEST_MAIN(TimesInIntervalTest)
 
 using namespace KCalendarCore;
@@ -305,4 +307,254 @@ void TimesInIntervalTest::testRDatePeriod()
     QVERIFY(!recur.rDateTimePeriod(start).isValid());
 }
 
+void TimesInIntervalTest::testFastPathRules_data()
+{
+    QTest::addColumn<int>("type");
+    QTest::addColumn<int>("frequency");
+    QTest::addColumn<QList<int>>("byDays");
+    QTest::addColumn<QList<int>>("byMonthDays");
+    QTest::addColumn<int>("duration");
+    QTest::addColumn<QDateTime>("start");
+
+    const QTimeZone berlin("Europe/Berlin");
+    // 02:30 does not exist on the days daylight saving time starts
+    const QDateTime gapTime(QDate(2019, 11, 29), QTime(2, 30), berlin);
+    const QDateTime start(QDate(2019, 11, 29), QTime(9, 15, 30), berlin);
+
+    QTest::newRow("daily") << int(RecurrenceRule::rDaily) << 1 << QList<int>() << QList<int>() << -1 << start;
+    QTest::newRow("daily every 3 days") << int(RecurrenceRule::rDaily) << 3 << QList<int>() << QList<int>() << -1 << start;
+    QTest::newRow("daily in dst gap") << int(RecurrenceRule::rDaily) << 1 << QList<int>() << QList<int>() << -1 << gapTime;
+    QTest::newRow("daily count") << int(RecurrenceRule::rDaily) << 2 << QList<int>() << QList<int>() << 100 << start;
+    QTest::newRow("weekly") << int(RecurrenceRule::rWeekly) << 1 << QList<int>() << QList<int>() << -1 << start;
+    QTest::newRow("weekly byday") << int(RecurrenceRule::rWeekly) << 2 << QList<int>{1, 3, 6} << QList<int>() << -1 << start;
+    QTest::newRow("weekly byday count") << int(RecurrenceRule::rWeekly) << 3 << QList<int>{2, 7} << QList<int>() << 50 << start;
+    QTest::newRow("monthly") << int(RecurrenceRule::rMonthly) << 1 << QList<int>() << QList<int>() << -1 << start;
+    QTest::newRow("monthly on the 31st") << int(RecurrenceRule::rMonthly) << 1 << QList<int>() << QList<int>{31} << -1 << start;
+    QTest::newRow("monthly bymonthday") << int(RecurrenceRule::rMonthly) << 2 << QList<int>{} << QList<int>{1, 15, -1} << -1 << start;
+    QTest::newRow("monthly bymonthday count") << int(RecurrenceRule::rMonthly) << 1 << QList<int>{} << QList<int>{-3, 30} << 30 << start;
+}
+
+// The compiled fast paths of RecurrenceRule must give the same results as
+// the general algorithm, which is used as soon as BYHOUR is set.
+void TimesInIntervalTest::testFastPathRules()
+{
+    QFETCH(int, type);
+    QFETCH(int, frequency);
+    QFETCH(QList<int>, byDays);
+    QFETCH(QList<int>, byMonthDays);
+    QFETCH(int, duration);
+    QFETCH(QDateTime, start);
+
+    RecurrenceRule fast;
+    fast.setRecurrenceType(static_cast<RecurrenceRule::PeriodType>(type));
+    fast.setStartDt(start);
+    fast.setFrequency(frequency);
+    QList<RecurrenceRule::WDayPos> wdays;
+    for (int day : std::as_const(byDays)) {
+        wdays << RecurrenceRule::WDayPos(0, day);
+    }
+    fast.setByDays(wdays);
+    fast.setByMonthDays(byMonthDays);
+    fast.setDuration(duration);
+
+    RecurrenceRule general(fast);
+    general.setByHours(QList<int>{start.time().hour()});
+
+    const QDateTime from = start.addDays(-10);
+    const QDateTime to = start.addYears(3);
+    QCOMPARE(fast.timesInInterval(from, to), general.timesInInterval(from, to));
+    QCOMPARE(fast.timesInInterval(start.addDays(40), to), general.timesInInterval(start.addDays(40), to));
+    QCOMPARE(fast.durationTo(to), general.durationTo(to));
+    if (duration > 0) {
+        QCOMPARE(fast.endDt(), general.endDt());
+    }
+
+    for (QDateTime dt = from; dt < to; dt = dt.addSecs(13 * 3600 + 7)) {
+        QCOMPARE(fast.getNextDate(dt), general.getNextDate(dt));
+        QCOMPARE(fast.getPreviousDate(dt), general.getPreviousDate(dt));
+        QCOMPARE(fast.recursOn(dt.date(), start.timeZone()), general.recursOn(dt.date(), start.timeZone()));
+    }
+
+    const QList<QDateTime> occurrences = general.timesInInterval(from, to);
+    for (const QDateTime &dt : occurrences) {
+        QVERIFY(fast.recursAt(dt));
+        QVERIFY(!fast.recursAt(dt.addSecs(1)));
+    }
+}
+
+void TimesInIntervalTest::testCachedRecursOn()
+{
+    const QTimeZone berlin("Europe/Berlin");
+    const QTimeZone zones[] = {berlin, QTimeZone("Pacific/Auckland"), QTimeZone::utc()};
+    const QDate from(2024, 1, 1);
+    const QDate to(2024, 6, 30);
+
+    Event::List events;
+    const auto addEvent = [&events](const QDateTime &start, bool allDay) {
+        Event::Ptr event(new Event);
+        event->setDtStart(start);
+        event->setAllDay(allDay);
+        events.append(event);
+        return event->recurrence();
+    };
+    Recurrence *recurrence = addEvent(QDateTime(QDate(2023, 12, 20), QTime(23, 30), berlin), false);
+    recurrence->setDaily(2);
+    recurrence->addExDateTime(QDateTime(QDate(2024, 1, 3), QTime(23, 30), berlin));
+    recurrence->addExDate(QDate(2024, 2, 1));
+    recurrence = addEvent(QDateTime(QDate(2024, 1, 1), QTime(0, 0), berlin), true);
+    recurrence->setWeekly(1);
+    recurrence->addRDate(QDate(2024, 3, 14));
+    recurrence->addExDate(QDate(2024, 1, 15));
+    recurrence = addEvent(QDateTime(QDate(2024, 1, 31), QTime(0, 0), berlin), false);
+    recurrence->setMonthly(1);
+    recurrence->addRDateTime(QDateTime(QDate(2024, 4, 2), QTime(6, 0), QTimeZone::utc()));
+    recurrence->setEndDate(QDate(2024, 5, 31));
+
+    for (const auto &event : events) {
+        for (const QTimeZone &zone : zones) {
+            Recurrence *r = event->recurrence();
+            QList<bool> expected;
+            QList<QDate> expectedDays;
+            for (QDate date = from; date <= to; date = date.addDays(1)) {
+                expected.append(r->recursOn(date, zone));
+                if (expected.constLast()) {
+                    expectedDays.append(date);
+                }
+            }
+            QCOMPARE(r->recurringDays(from, to, zone), expectedDays);
+            r->cacheRecursOn(from.addDays(10), to, zone);
+            int i = 0;
+            for (QDate date = from; date <= to; date = date.addDays(1), ++i) {
+                QCOMPARE(r->recursOn(date, zone), expected.at(i));
+            }
+        }
+    }
+
+    // Changing the recurrence drops the cache.
+    Recurrence *r = events.first()->recurrence();
+    r->cacheRecursOn(from, to, berlin);
+    QVERIFY(r->recursOn(QDate(2024, 1, 5), berlin));
+    QVERIFY(r->recursOn(from, berlin));
+    QVERIFY(!r->recursOn(QDate(), berlin));
+    r->addExDate(QDate(2024, 1, 5));
+    QVERIFY(!r->recursOn(QDate(2024, 1, 5), berlin));
+}
+
+void TimesInIntervalTest::testRuleWindow_data()
+{
+    QTest::addColumn<QString>("rrule");
+
+    QTest::newRow("weekly byhour") << QStringLiteral("FREQ=WEEKLY;BYDAY=MO,TH;BYHOUR=9,17");
+    QTest::newRow("monthly bysetpos") << QStringLiteral("FREQ=MONTHLY;BYDAY=MO,TU,WE,TH,FR;BYSETPOS=-1");
+    QTest::newRow("yearly until") << QStringLiteral("FREQ=YEARLY;BYMONTH=3,9;BYDAY=2SU;UNTIL=20301231T000000Z");
+    QTest::newRow("daily byhour until") << QStringLiteral("FREQ=DAILY;INTERVAL=3;BYHOUR=8,20;UNTIL=20260601T000000Z");
+}
+
+// Rules without a cache keep the occurrences of the intervals last requested,
+// which must not change the results of later queries.
+void TimesInIntervalTest::testRuleWindow()
+{
+    QFETCH(QString, rrule);
+
+    const QDateTime start(QDate(2024, 1, 15), QTime(9, 0), QTimeZone("Europe/Berlin"));
+    RecurrenceRule rule;
+    ICalFormat format;
+    QVERIFY(format.fromString(&rule, rrule));
+    rule.setStartDt(start);
+
+    // Scroll forwards, backwards, then jump.
+    QList<QDateTime> windows;
+    for (int i = 0; i < 12; ++i) {
+        windows << start.addMonths(i);
+    }
+    for (int i = 12; i > -3; --i) {
+        windows << start.addMonths(i).addDays(-10);
+    }
+    windows << start.addYears(5) << start.addYears(5).addDays(-20) << start.addMonths(2);
+
+    for (const QDateTime &from : std::as_const(windows)) {
+        const QDateTime to = from.addMonths(1).addSecs(-1);
+        const RecurrenceRule fresh(rule);
+        QCOMPARE(rule.timesInInterval(from, to), fresh.timesInInterval(from, to));
+        QCOMPARE(rule.getNextDate(from.addDays(3)), RecurrenceRule(rule).getNextDate(from.addDays(3)));
+        QCOMPARE(rule.getPreviousDate(to.addDays(-3)), RecurrenceRule(rule).getPreviousDate(to.addDays(-3)));
+    }
+
+    // Changing the rule drops the window.
+    const QDateTime from = start.addMonths(1);
+    const QDateTime to = start.addMonths(3);
+    QVERIFY(!rule.timesInInterval(from, to).isEmpty() || rrule.contains(QLatin1String("UNTIL")));
+    rule.setFrequency(2);
+    QCOMPARE(rule.timesInInterval(from, to), RecurrenceRule(rule).timesInInterval(from, to));
+}
+
+void TimesInIntervalTest::testOccurrenceIndex_data()
+{
+    QTest::addColumn<QString>("rrule");
+    QTest::addColumn<QDateTime>("start");
+
+    const QDateTime utc(QDate(2024, 1, 17), QTime(9, 30), QTimeZone::utc());
+    const QDateTime berlin(QDate(2024, 1, 17), QTime(9, 30), QTimeZone("Europe/Berlin"));
+    QTest::newRow("hourly") << QStringLiteral("FREQ=HOURLY;INTERVAL=5") << berlin;
+    QTest::newRow("hourly count") << QStringLiteral("FREQ=HOURLY;INTERVAL=5;COUNT=100") << berlin;
+    QTest::newRow("daily utc") << QStringLiteral("FREQ=DAILY;INTERVAL=2") << utc;
+    QTest::newRow("daily utc until") << QStringLiteral("FREQ=DAILY;INTERVAL=2;UNTIL=20240601T000000Z") << utc;
+    QTest::newRow("weekly utc") << QStringLiteral("FREQ=WEEKLY;INTERVAL=3;BYDAY=MO,WE,SU") << utc;
+    QTest::newRow("weekly utc wkst") << QStringLiteral("FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,TU,SA;WKST=SU") << utc;
+    QTest::newRow("daily berlin") << QStringLiteral("FREQ=DAILY") << berlin;
+    const QDateTime fixed(QDate(2024, 1, 17), QTime(9, 30), QTimeZone("Etc/GMT-3"));
+    QTest::newRow("daily fixed zone") << QStringLiteral("FREQ=DAILY;INTERVAL=3") << fixed;
+    QTest::newRow("weekly fixed zone count") << QStringLiteral("FREQ=WEEKLY;BYDAY=TU,FR;COUNT=150") << fixed;
+    QTest::newRow("monthly") << QStringLiteral("FREQ=MONTHLY;BYMONTHDAY=1,17,-1") << berlin;
+    QTest::newRow("monthly bysetpos") << QStringLiteral("FREQ=MONTHLY;BYDAY=MO,TU,WE,TH,FR;BYSETPOS=-1") << berlin;
+    QTest::newRow("daily byhour until") << QStringLiteral("FREQ=DAILY;BYHOUR=8,20;UNTIL=20240501T000000Z") << berlin;
+}
+
+// occurrenceAt() and indexOf() must agree with enumerating the occurrences,
+// both for the rules counted arithmetically and for the others.
+void TimesInIntervalTest::testOccurrenceIndex()
+{
+    QFETCH(QString, rrule);
+    QFETCH(QDateTime, start);
+
+    RecurrenceRule rule;
+    ICalFormat format;
+    QVERIFY(format.fromString(&rule, rrule));
+    rule.setStartDt(start);
+
+    QList<QDateTime> occurrences;
+    QDateTime next = rule.getNextDate(start.addSecs(-1));
+    for (; next.isValid() && occurrences.count() < 300; next = rule.getNextDate(next)) {
+        occurrences += next;
+    }
+    QVERIFY(!occurrences.isEmpty());
+
+    // Look them up out of order, to use the checkpoints of earlier lookups
+    for (int i = occurrences.count() - 1; i >= 0; i -= 7) {
+        QCOMPARE(rule.occurrenceAt(i), occurrences.at(i));
+    }
+    for (int i = 0; i < occurrences.count(); ++i) {
+        const QDateTime &dt = occurrences.at(i);
+        QCOMPARE(rule.occurrenceAt(i), dt);
+        QCOMPARE(rule.occurrenceAt(i).timeZone(), start.timeZone());
+        QCOMPARE(rule.indexOf(dt), i);
+        QCOMPARE(rule.indexOf(dt.toTimeZone(QTimeZone("America/New_York"))), i);
+        QCOMPARE(rule.indexOf(dt.addSecs(60)), -1);
+        QCOMPARE(RecurrenceRule(rule).indexOf(dt), i);
+        if (rule.recurrenceType() > RecurrenceRule::rHourly) {
+            QCOMPARE(rule.durationTo(dt.addSecs(60)), i + 1);
+        }
+    }
+    QCOMPARE(rule.indexOf(start.addDays(-1)), -1);
+    QCOMPARE(rule.occurrenceAt(-1), QDateTime());
+    // Only a rule that ran out before the 300 collected occurrences has no more
+    if (!next.isValid()) {
+        QVERIFY(rule.duration() >= 0);
+        QCOMPARE(rule.occurrenceAt(occurrences.count()), QDateTime());
+    }
+    if (rule.duration() > 0) {
+        QCOMPARE(rule.endDt(), occurrences.constLast());
+    }
+}
+
 #include "moc_testtimesininterval.cpp"
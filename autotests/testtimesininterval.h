@@ -24,6 +24,13 @@ private Q_SLOTS:
     void testLocalTimeHandlingAllDay();
     void testByDayRecurrence();
     void testRDatePeriod();
+    void testFastPathRules_data();
+    void testFastPathRules();
+    void testCachedRecursOn();
+    void testRuleWindow_data();
+    void testRuleWindow();
+    void testOccurrenceIndex_data();
+    void testOccurrenceIndex();
 };
 
 #endif
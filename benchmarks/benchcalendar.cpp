@@ -0,0 +1,201 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "benchcalendar.h"
+#include "calendargenerator.h"
+#include "freebusy.h"
+#include "icalformat.h"
+#include "occurrenceiterator.h"
+#include "vcalformat.h"
+
+#include <QTemporaryFile>
+#include <QTest>
+#include <QTimeZone>
+QTEST_MAIN(CalendarBenchmark)
+
+using namespace KCalendarCore;
+
+// Queries look at the middle of the generated period.
+static QDateTime queryStart(const Calendar::Ptr &cal)
+{
+    return QDateTime(CalendarGenerator::firstDate().addDays(365), QTime(0, 0), cal->timeZone());
+}
+
+void CalendarBenchmark::benchICalLoad_data()
+{
+    CalendarGenerator::addSizes();
+}
+
+void CalendarBenchmark::benchICalLoad()
+{
+    QFETCH(int, count);
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.close();
+    ICalFormat format;
+    QVERIFY(format.save(CalendarGenerator().calendar(count), file.fileName()));
+
+    QBENCHMARK {
+        MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+        QVERIFY(format.load(cal, file.fileName()));
+    }
+}
+
+void CalendarBenchmark::benchICalToString_data()
+{
+    CalendarGenerator::addSizes();
+}
+
+void CalendarBenchmark::benchICalToString()
+{
+    QFETCH(int, count);
+    const auto cal = CalendarGenerator().calendar(count);
+    ICalFormat format;
+
+    QBENCHMARK {
+        const QString data = format.toString(cal);
+        Q_UNUSED(data);
+    }
+}
+
+void CalendarBenchmark::benchVCalLoad_data()
+{
+    CalendarGenerator::addSizes();
+}
+
+void CalendarBenchmark::benchVCalLoad()
+{
+    QFETCH(int, count);
+    const QByteArray data = CalendarGenerator().vCalendar(count);
+    VCalFormat format;
+
+    QBENCHMARK {
+        MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+        QVERIFY(format.fromRawString(cal, data));
+    }
+}
+
+void CalendarBenchmark::benchRawEvents_data()
+{
+    CalendarGenerator::addSizes();
+}
+
+void CalendarBenchmark::benchRawEvents()
+{
+    QFETCH(int, count);
+    const auto cal = CalendarGenerator().calendar(count);
+    const QDate start = queryStart(cal).date();
+
+    QBENCHMARK {
+        const auto events = cal->rawEvents(start, start.addDays(6));
+        Q_UNUSED(events);
+    }
+}
+
+void CalendarBenchmark::benchRawEventsForDate_data()
+{
+    CalendarGenerator::addSizes();
+}
+
+void CalendarBenchmark::benchRawEventsForDate()
+{
+    QFETCH(int, count);
+    const auto cal = CalendarGenerator().calendar(count);
+    const QDate date = queryStart(cal).date();
+
+    QBENCHMARK {
+        const auto events = cal->rawEventsForDate(date);
+        Q_UNUSED(events);
+    }
+}
+
+void CalendarBenchmark::benchAlarms_data()
+{
+    CalendarGenerator::addSizes();
+}
+
+void CalendarBenchmark::benchAlarms()
+{
+    QFETCH(int, count);
+    const auto cal = CalendarGenerator().calendar(count);
+    const QDateTime start = queryStart(cal);
+
+    QBENCHMARK {
+        const auto alarms = cal->alarms(start, start.addDays(1));
+        Q_UNUSED(alarms);
+    }
+}
+
+void CalendarBenchmark::benchOccurrenceIterator_data()
+{
+    CalendarGenerator::addSizes();
+}
+
+void CalendarBenchmark::benchOccurrenceIterator()
+{
+    QFETCH(int, count);
+    const auto cal = CalendarGenerator().calendar(count);
+    const QDateTime start = queryStart(cal);
+
+    QBENCHMARK {
+        OccurrenceIterator it(*cal, start, start.addMonths(1));
+        int occurrences = 0;
+        while (it.hasNext()) {
+            it.next();
+            ++occurrences;
+        }
+        Q_UNUSED(occurrences);
+    }
+}
+
+void CalendarBenchmark::benchFreeBusy_data()
+{
+    CalendarGenerator::addSizes();
+}
+
+void CalendarBenchmark::benchFreeBusy()
+{
+    QFETCH(int, count);
+    const auto cal = CalendarGenerator().calendar(count);
+    const QDateTime start = queryStart(cal);
+    const QDateTime end = start.addMonths(1);
+
+    QBENCHMARK {
+        FreeBusy freeBusy(cal->rawEvents(start.date(), end.date()), start, end);
+        Q_UNUSED(freeBusy);
+    }
+}
+
+void CalendarBenchmark::benchTimesInInterval_data()
+{
+    CalendarGenerator::addSizes();
+}
+
+void CalendarBenchmark::benchTimesInInterval()
+{
+    QFETCH(int, count);
+    const auto cal = CalendarGenerator().calendar(count);
+    const QDateTime start = queryStart(cal);
+    const QDateTime end = start.addMonths(1);
+    QList<RecurrenceRule *> rules;
+    const Event::List events = cal->rawEvents();
+    for (const Event::Ptr &event : events) {
+        if (event->recurs()) {
+            rules += event->recurrence()->rRules();
+        }
+    }
+
+    QBENCHMARK {
+        for (const RecurrenceRule *rule : std::as_const(rules)) {
+            const auto times = rule->timesInInterval(start, end);
+            Q_UNUSED(times);
+        }
+    }
+}
+
+#include "moc_benchcalendar.cpp"
@@ -0,0 +1,38 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef BENCHCALENDAR_H
+#define BENCHCALENDAR_H
+
+#include <QObject>
+
+class CalendarBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void benchICalLoad_data();
+    void benchICalLoad();
+    void benchICalToString_data();
+    void benchICalToString();
+    void benchVCalLoad_data();
+    void benchVCalLoad();
+    void benchRawEvents_data();
+    void benchRawEvents();
+    void benchRawEventsForDate_data();
+    void benchRawEventsForDate();
+    void benchAlarms_data();
+    void benchAlarms();
+    void benchOccurrenceIterator_data();
+    void benchOccurrenceIterator();
+    void benchFreeBusy_data();
+    void benchFreeBusy();
+    void benchTimesInInterval_data();
+    void benchTimesInInterval();
+};
+
+#endif
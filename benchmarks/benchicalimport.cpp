@@ -0,0 +1,62 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "benchicalimport.h"
+#include "calendargenerator.h"
+#include "icalformat.h"
+#include "memorycalendar.h"
+
+#include <QTest>
+#include <QThread>
+#include <QTimeZone>
+QTEST_MAIN(ICalImportBenchmark)
+
+using namespace KCalendarCore;
+
+static const int incidenceCount = 20000;
+
+void ICalImportBenchmark::initTestCase()
+{
+    const auto cal = CalendarGenerator().calendar(incidenceCount);
+    mIncidenceCount = cal->rawIncidences().count();
+
+    QVERIFY(mFile.open());
+    mFile.close();
+    ICalFormat format;
+    QVERIFY(format.save(cal, mFile.fileName()));
+}
+
+void ICalImportBenchmark::benchLoad_data()
+{
+    QTest::addColumn<int>("threads");
+    QTest::newRow("default") << 1;
+    for (int threads : {1, 2, 4, 8, 16}) {
+        if (threads <= QThread::idealThreadCount()) {
+            QTest::addRow("%d threads", threads) << threads;
+        }
+    }
+}
+
+void ICalImportBenchmark::benchLoad()
+{
+    QFETCH(int, threads);
+    ICalFormat format;
+    // The "default" row measures the regular, non-batched load.
+    if (QByteArray(QTest::currentDataTag()) != "default") {
+        format.setStreamingLoad(true);
+        format.setLoadThreadCount(threads);
+    }
+
+    QBENCHMARK {
+        MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+        QVERIFY(format.load(cal, mFile.fileName()));
+        QCOMPARE(cal->rawIncidences().count(), mIncidenceCount);
+    }
+}
+
+#include "moc_benchicalimport.cpp"
@@ -0,0 +1,28 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef BENCHICALIMPORT_H
+#define BENCHICALIMPORT_H
+
+#include <QObject>
+#include <QTemporaryFile>
+
+class ICalImportBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void benchLoad_data();
+    void benchLoad();
+
+private:
+    QTemporaryFile mFile;
+    int mIncidenceCount = 0;
+};
+
+#endif
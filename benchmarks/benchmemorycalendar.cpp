@@ -0,0 +1,80 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "benchmemorycalendar.h"
+#include "calendargenerator.h"
+#include "memorycalendar.h"
+
+#include <QTest>
+#include <QTimeZone>
+QTEST_MAIN(MemoryCalendarBenchmark)
+
+using namespace KCalendarCore;
+
+// The range filter rawEvents() applied to every event before it was indexed.
+static Event::List linearRawEvents(const MemoryCalendar::Ptr &cal, const QDate &start, const QDate &end)
+{
+    Event::List eventList;
+    const QDateTime st(start, QTime(0, 0, 0), cal->timeZone());
+    const QDateTime nd(end, QTime(23, 59, 59, 999), cal->timeZone());
+    const Event::List events = cal->rawEvents();
+    for (const Event::Ptr &event : events) {
+        if (nd < event->dtStart()) {
+            continue;
+        }
+        if (!event->recurs()) {
+            if (event->dtEnd() < st) {
+                continue;
+            }
+        } else if (event->recurrence()->duration() != -1) {
+            const QDateTime rEnd(event->recurrence()->endDate(), QTime(23, 59, 59, 999), cal->timeZone());
+            if (!rEnd.isValid() || rEnd < st) {
+                continue;
+            }
+        }
+        eventList.append(event);
+    }
+    return eventList;
+}
+
+void MemoryCalendarBenchmark::benchRawEventsRange_data()
+{
+    CalendarGenerator::addSizes();
+}
+
+void MemoryCalendarBenchmark::benchRawEventsRange()
+{
+    QFETCH(int, count);
+    const auto cal = CalendarGenerator().calendar(count);
+    const QDate weekStart = CalendarGenerator::firstDate().addDays(365);
+    QCOMPARE(cal->rawEvents(weekStart, weekStart.addDays(6)).count(), linearRawEvents(cal, weekStart, weekStart.addDays(6)).count());
+
+    QBENCHMARK {
+        const auto events = cal->rawEvents(weekStart, weekStart.addDays(6));
+        Q_UNUSED(events);
+    }
+}
+
+void MemoryCalendarBenchmark::benchRawEventsLinearScan_data()
+{
+    CalendarGenerator::addSizes();
+}
+
+void MemoryCalendarBenchmark::benchRawEventsLinearScan()
+{
+    QFETCH(int, count);
+    const auto cal = CalendarGenerator().calendar(count);
+    const QDate weekStart = CalendarGenerator::firstDate().addDays(365);
+
+    QBENCHMARK {
+        const auto events = linearRawEvents(cal, weekStart, weekStart.addDays(6));
+        Q_UNUSED(events);
+    }
+}
+
+#include "moc_benchmemorycalendar.cpp"
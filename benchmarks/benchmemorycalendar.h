@@ -0,0 +1,24 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef BENCHMEMORYCALENDAR_H
+#define BENCHMEMORYCALENDAR_H
+
+#include <QObject>
+
+class MemoryCalendarBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void benchRawEventsRange_data();
+    void benchRawEventsRange();
+    void benchRawEventsLinearScan_data();
+    void benchRawEventsLinearScan();
+};
+
+#endif
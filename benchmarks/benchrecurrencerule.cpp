@@ -0,0 +1,186 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "benchrecurrencerule.h"
+#include "recurrencerule.h"
+
+#include <QTest>
+#include <QTimeZone>
+
+#include <memory>
+#include <vector>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+QTEST_MAIN(RecurrenceRuleBenchmark)
+
+using namespace KCalendarCore;
+
+static const QDateTime ruleStart(QDate(2020, 1, 6), QTime(9, 30), QTimeZone("Europe/Berlin"));
+
+// Each rule shape is measured as is, which uses its compiled fast path where
+// there is one, and with an equivalent BYHOUR which forces the general
+// constraint based evaluation.
+static void addRules()
+{
+    QTest::addColumn<int>("type");
+    QTest::addColumn<QList<int>>("byDays");
+    QTest::addColumn<QList<int>>("byMonthDays");
+    QTest::addColumn<bool>("general");
+
+    for (bool general : {false, true}) {
+        const char *suffix = general ? " general" : "";
+        QTest::addRow("daily%s", suffix) << int(RecurrenceRule::rDaily) << QList<int>() << QList<int>() << general;
+        QTest::addRow("weekly byday%s", suffix) << int(RecurrenceRule::rWeekly) << QList<int>{1, 3, 5} << QList<int>() << general;
+        QTest::addRow("monthly bymonthday%s", suffix) << int(RecurrenceRule::rMonthly) << QList<int>() << QList<int>{1, 15, -1} << general;
+        // Not compiled: BYDAY with a position
+        QTest::addRow("monthly byday pos%s", suffix) << int(RecurrenceRule::rMonthly) << QList<int>{-1} << QList<int>() << general;
+    }
+}
+
+static RecurrenceRule *makeRule()
+{
+    QFETCH(int, type);
+    QFETCH(QList<int>, byDays);
+    QFETCH(QList<int>, byMonthDays);
+    QFETCH(bool, general);
+
+    auto rule = new RecurrenceRule;
+    rule->setRecurrenceType(static_cast<RecurrenceRule::PeriodType>(type));
+    rule->setStartDt(ruleStart);
+    rule->setFrequency(1);
+    QList<RecurrenceRule::WDayPos> wdays;
+    for (int day : std::as_const(byDays)) {
+        // Negative values select the last Friday of the period
+        wdays << (day > 0 ? RecurrenceRule::WDayPos(0, day) : RecurrenceRule::WDayPos(day, 5));
+    }
+    rule->setByDays(wdays);
+    rule->setByMonthDays(byMonthDays);
+    if (general) {
+        rule->setByHours(QList<int>{ruleStart.time().hour()});
+    }
+    return rule;
+}
+
+void RecurrenceRuleBenchmark::benchTimesInInterval_data()
+{
+    addRules();
+}
+
+void RecurrenceRuleBenchmark::benchTimesInInterval()
+{
+    std::unique_ptr<RecurrenceRule> rule(makeRule());
+    const QDateTime from = ruleStart.addYears(2);
+    const QDateTime to = from.addYears(1);
+
+    QBENCHMARK {
+        const auto dts = rule->timesInInterval(from, to);
+        Q_UNUSED(dts);
+    }
+}
+
+void RecurrenceRuleBenchmark::benchNextDate_data()
+{
+    addRules();
+}
+
+void RecurrenceRuleBenchmark::benchNextDate()
+{
+    std::unique_ptr<RecurrenceRule> rule(makeRule());
+
+    QBENCHMARK {
+        QDateTime dt = ruleStart.addYears(2);
+        for (int i = 0; i < 100 && dt.isValid(); ++i) {
+            dt = rule->getNextDate(dt);
+        }
+    }
+}
+
+void RecurrenceRuleBenchmark::benchRecursOn_data()
+{
+    addRules();
+}
+
+void RecurrenceRuleBenchmark::benchRecursOn()
+{
+    std::unique_ptr<RecurrenceRule> rule(makeRule());
+    const QDate from = ruleStart.date().addYears(2);
+
+    QBENCHMARK {
+        for (QDate date = from; date < from.addYears(1); date = date.addDays(1)) {
+            rule->recursOn(date, ruleStart.timeZone());
+        }
+    }
+}
+
+// Bytes of heap memory in use, or -1 where this cannot be measured.
+static qint64 heapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return static_cast<qint64>(mallinfo2().uordblks);
+#else
+    return -1;
+#endif
+}
+
+void RecurrenceRuleBenchmark::benchCacheMemory_data()
+{
+    QTest::addColumn<bool>("dateTimes");
+
+    // The occurrence cache of the rules, and for comparison the same
+    // occurrences kept as QDateTime lists, as the cache used to store them.
+    QTest::newRow("rule cache") << false;
+    QTest::newRow("QDateTime lists") << true;
+}
+
+// Reports the heap memory taken by the occurrence cache of many COUNT
+// limited rules, as if each incidence of a large calendar had one.
+void RecurrenceRuleBenchmark::benchCacheMemory()
+{
+    QFETCH(bool, dateTimes);
+    static const int ruleCount = 1000;
+    static const int occurrenceCount = 500;
+
+    if (heapInUse() < 0) {
+        QSKIP("Heap usage can only be measured with glibc");
+    }
+
+    std::vector<std::unique_ptr<RecurrenceRule>> rules;
+    rules.reserve(ruleCount);
+    for (int i = 0; i < ruleCount; ++i) {
+        auto rule = std::make_unique<RecurrenceRule>();
+        rule->setRecurrenceType(RecurrenceRule::rWeekly);
+        rule->setStartDt(ruleStart.addDays(i % 7).addSecs(900 * (i % 40)));
+        rule->setFrequency(1);
+        rule->setByDays({RecurrenceRule::WDayPos(0, 1), RecurrenceRule::WDayPos(0, 3), RecurrenceRule::WDayPos(0, 5)});
+        rule->setDuration(occurrenceCount);
+        rules.push_back(std::move(rule));
+    }
+
+    std::vector<QList<QDateTime>> lists;
+    lists.reserve(ruleCount);
+    const qint64 before = heapInUse();
+    for (const auto &rule : rules) {
+        if (dateTimes) {
+            // Enumerated on a copy, whose own cache is freed right away
+            const RecurrenceRule copy(*rule);
+            QList<QDateTime> dts;
+            dts.reserve(occurrenceCount);
+            for (QDateTime dt = copy.getNextDate(copy.startDt().addSecs(-1)); dt.isValid() && dts.count() < occurrenceCount; dt = copy.getNextDate(dt)) {
+                dts.append(dt);
+            }
+            lists.push_back(std::move(dts));
+        } else {
+            QVERIFY(rule->endDt().isValid());
+        }
+    }
+    QTest::setBenchmarkResult(heapInUse() - before, QTest::BytesAllocated);
+}
+
+#include "moc_benchrecurrencerule.cpp"
@@ -0,0 +1,28 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef BENCHRECURRENCERULE_H
+#define BENCHRECURRENCERULE_H
+
+#include <QObject>
+
+class RecurrenceRuleBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void benchTimesInInterval_data();
+    void benchTimesInInterval();
+    void benchNextDate_data();
+    void benchNextDate();
+    void benchRecursOn_data();
+    void benchRecursOn();
+    void benchCacheMemory_data();
+    void benchCacheMemory();
+};
+
+#endif
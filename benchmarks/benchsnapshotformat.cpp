@@ -0,0 +1,69 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "benchsnapshotformat.h"
+#include "calendargenerator.h"
+#include "icalformat.h"
+#include "memorycalendar.h"
+#include "snapshotformat.h"
+
+#include <QFileInfo>
+#include <QTest>
+#include <QTimeZone>
+QTEST_MAIN(SnapshotFormatBenchmark)
+
+using namespace KCalendarCore;
+
+static const int incidenceCount = 20000;
+
+void SnapshotFormatBenchmark::initTestCase()
+{
+    const auto cal = CalendarGenerator().calendar(incidenceCount);
+    mIncidenceCount = cal->rawIncidences().count();
+    QVERIFY(mICalFile.open());
+    mICalFile.close();
+    QVERIFY(mSnapshotFile.open());
+    mSnapshotFile.close();
+
+    ICalFormat iCal;
+    QVERIFY(iCal.save(cal, mICalFile.fileName()));
+    SnapshotFormat snapshot;
+    QVERIFY(snapshot.save(cal, mSnapshotFile.fileName()));
+    qDebug() << "iCalendar size:" << QFileInfo(mICalFile.fileName()).size() << "snapshot size:" << QFileInfo(mSnapshotFile.fileName()).size();
+}
+
+void SnapshotFormatBenchmark::benchICalLoad()
+{
+    ICalFormat format;
+    QBENCHMARK {
+        MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+        QVERIFY(format.load(cal, mICalFile.fileName()));
+        QCOMPARE(cal->rawIncidences().count(), mIncidenceCount);
+    }
+}
+
+void SnapshotFormatBenchmark::benchSnapshotLoad()
+{
+    SnapshotFormat format;
+    QBENCHMARK {
+        MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+        QVERIFY(format.load(cal, mSnapshotFile.fileName()));
+        QCOMPARE(cal->rawIncidences().count(), mIncidenceCount);
+    }
+}
+
+void SnapshotFormatBenchmark::benchSnapshotSave()
+{
+    const auto cal = CalendarGenerator().calendar(incidenceCount);
+    SnapshotFormat format;
+    QBENCHMARK {
+        QVERIFY(format.save(cal, mSnapshotFile.fileName()));
+    }
+}
+
+#include "moc_benchsnapshotformat.cpp"
@@ -0,0 +1,30 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef BENCHSNAPSHOTFORMAT_H
+#define BENCHSNAPSHOTFORMAT_H
+
+#include <QObject>
+#include <QTemporaryFile>
+
+class SnapshotFormatBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void benchICalLoad();
+    void benchSnapshotLoad();
+    void benchSnapshotSave();
+
+private:
+    QTemporaryFile mICalFile;
+    QTemporaryFile mSnapshotFile;
+    int mIncidenceCount = 0;
+};
+
+#endif
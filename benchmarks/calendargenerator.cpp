@@ -0,0 +1,231 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "calendargenerator.h"
+
+#include <QBitArray>
+#include <QTest>
+#include <QTimeZone>
+
+using namespace KCalendarCore;
+
+static const int spanDays = 730;
+
+CalendarGenerator::CalendarGenerator(quint32 seed)
+    : mRandom(seed)
+{
+}
+
+QDate CalendarGenerator::firstDate()
+{
+    return QDate(2024, 1, 1);
+}
+
+void CalendarGenerator::addSizes()
+{
+    QTest::addColumn<int>("count");
+    QList<QByteArray> sizes = qgetenv("KCALCORE_BENCHMARK_SIZES").split(',');
+    sizes.removeAll(QByteArray());
+    if (sizes.isEmpty()) {
+        sizes = {"1000", "10000"};
+    }
+    for (const QByteArray &size : std::as_const(sizes)) {
+        bool ok = false;
+        const int count = size.trimmed().toInt(&ok);
+        if (ok && count > 0) {
+            QTest::addRow("%d", count) << count;
+        }
+    }
+}
+
+MemoryCalendar::Ptr CalendarGenerator::calendar(int count)
+{
+    const QTimeZone berlin("Europe/Berlin");
+    const QTimeZone zones[] = {berlin, berlin, berlin, QTimeZone::utc(), QTimeZone("America/New_York")};
+
+    MemoryCalendar::Ptr cal(new MemoryCalendar(berlin));
+    cal->startBatchAdding();
+    for (int i = 0; i < count; ++i) {
+        const QTimeZone &zone = zones[mRandom.bounded(5)];
+        const int kind = mRandom.bounded(100);
+        if (kind < 60) {
+            cal->addEvent(event(zone));
+        } else if (kind < 75) {
+            const Event::Ptr recurring = event(zone);
+            makeRecurring(recurring);
+            cal->addEvent(recurring);
+            // One in ten recurring events has a moved occurrence
+            if (mRandom.bounded(10) == 0) {
+                const QDateTime occurrence = recurring->recurrence()->getNextDateTime(recurring->dtStart());
+                if (occurrence.isValid()) {
+                    Event::Ptr exception(recurring->clone());
+                    exception->clearRecurrence();
+                    exception->setRecurrenceId(occurrence);
+                    exception->setDtStart(occurrence.addSecs(3600));
+                    exception->setDtEnd(recurring->dtEnd().addSecs(recurring->dtStart().secsTo(occurrence) + 3600));
+                    cal->addEvent(exception);
+                    ++i;
+                }
+            }
+        } else if (kind < 92) {
+            cal->addTodo(todo(zone));
+        } else {
+            cal->addJournal(journal(zone));
+        }
+    }
+    cal->endBatchAdding();
+    return cal;
+}
+
+QDateTime CalendarGenerator::randomStart(const QTimeZone &zone)
+{
+    const QDate date = firstDate().addDays(mRandom.bounded(spanDays));
+    return QDateTime(date, QTime(7 + mRandom.bounded(12), 15 * mRandom.bounded(4)), zone);
+}
+
+Event::Ptr CalendarGenerator::event(const QTimeZone &zone)
+{
+    Event::Ptr event(new Event);
+    const QDateTime start = randomStart(zone);
+    const int shape = mRandom.bounded(20);
+    if (shape == 0) {
+        // All day event, from one to three days
+        event->setDtStart(QDateTime(start.date(), QTime(0, 0), zone));
+        event->setDtEnd(QDateTime(start.date().addDays(mRandom.bounded(3)), QTime(0, 0), zone));
+        event->setAllDay(true);
+    } else if (shape == 1) {
+        // Multi-day event
+        event->setDtStart(start);
+        event->setDtEnd(start.addDays(1 + mRandom.bounded(4)));
+    } else {
+        event->setDtStart(start);
+        event->setDtEnd(start.addSecs(60 * (30 + 15 * mRandom.bounded(7))));
+    }
+    event->setSummary(QStringLiteral("Event %1").arg(++mSerial));
+    event->setLocation(QStringLiteral("Room %1").arg(mRandom.bounded(50)));
+    addDetails(event);
+    return event;
+}
+
+void CalendarGenerator::makeRecurring(const Event::Ptr &event)
+{
+    Recurrence *recurrence = event->recurrence();
+    const QDate startDate = event->dtStart().date();
+    switch (mRandom.bounded(6)) {
+    case 0:
+        recurrence->setDaily(1);
+        recurrence->setDuration(5 + mRandom.bounded(26));
+        break;
+    case 1: {
+        QBitArray days(7);
+        days.setBit(0);
+        days.setBit(2);
+        days.setBit(4);
+        recurrence->setWeekly(1, days);
+        break;
+    }
+    case 2:
+        recurrence->setWeekly(2);
+        recurrence->setEndDate(startDate.addYears(1));
+        break;
+    case 3:
+        recurrence->setMonthly(1);
+        recurrence->addMonthlyDate(startDate.day());
+        recurrence->setDuration(12);
+        break;
+    case 4:
+        // Last Friday of the month
+        recurrence->setMonthly(1);
+        recurrence->addMonthlyPos(-1, 5);
+        break;
+    default:
+        // Birthday
+        event->setDtStart(QDateTime(startDate, QTime(0, 0), event->dtStart().timeZone()));
+        event->setDtEnd(event->dtStart());
+        event->setAllDay(true);
+        recurrence->setYearly(1);
+        recurrence->addYearlyMonth(startDate.month());
+        recurrence->addYearlyDate(startDate.day());
+        break;
+    }
+    if (mRandom.bounded(5) == 0) {
+        recurrence->addExDate(startDate.addDays(7 * (1 + mRandom.bounded(4))));
+    }
+}
+
+Todo::Ptr CalendarGenerator::todo(const QTimeZone &zone)
+{
+    Todo::Ptr todo(new Todo);
+    const QDateTime due = randomStart(zone);
+    todo->setDtStart(due.addDays(-mRandom.bounded(10)));
+    todo->setDtDue(due);
+    todo->setSummary(QStringLiteral("To-do %1").arg(++mSerial));
+    todo->setPriority(mRandom.bounded(10));
+    if (mRandom.bounded(5) == 0) {
+        todo->recurrence()->setWeekly(1);
+    } else if (mRandom.bounded(3) == 0) {
+        todo->setCompleted(due);
+    }
+    addDetails(todo);
+    return todo;
+}
+
+Journal::Ptr CalendarGenerator::journal(const QTimeZone &zone)
+{
+    Journal::Ptr journal(new Journal);
+    journal->setDtStart(randomStart(zone));
+    journal->setSummary(QStringLiteral("Journal %1").arg(++mSerial));
+    journal->setDescription(QStringLiteral("Notes taken during the day.\nSecond line of notes."));
+    return journal;
+}
+
+void CalendarGenerator::addDetails(const Incidence::Ptr &incidence)
+{
+    incidence->setDescription(QStringLiteral("Description of %1, with a few more words to make it realistic.").arg(incidence->summary()));
+    if (mRandom.bounded(3) == 0) {
+        incidence->setCategories({QStringLiteral("Category %1").arg(mRandom.bounded(20))});
+    }
+    if (mRandom.bounded(10) == 0) {
+        incidence->setOrganizer(Person(QStringLiteral("Organizer"), QStringLiteral("organizer@example.com")));
+        for (int i = 0; i < 3; ++i) {
+            const int n = mRandom.bounded(1000);
+            incidence->addAttendee(Attendee(QStringLiteral("Attendee %1").arg(n), QStringLiteral("attendee%1@example.com").arg(n)));
+        }
+    }
+    if (mRandom.bounded(5) == 0) {
+        Alarm::Ptr alarm = incidence->newAlarm();
+        alarm->setStartOffset(Duration(-60 * 15));
+        alarm->setEnabled(true);
+    }
+}
+
+QByteArray CalendarGenerator::vCalendar(int count)
+{
+    static const char *const rules[] = {"D1 #10", "W1 MO WE FR #0", "MD1 15 #12", "YM1 #0"};
+
+    QByteArray data("BEGIN:VCALENDAR\r\nPRODID:-//K Desktop Environment//NONSGML KCalendarCore benchmark//EN\r\nVERSION:1.0\r\n");
+    for (int i = 0; i < count; ++i) {
+        const QDateTime start = randomStart(QTimeZone::utc());
+        const QByteArray dtStart = start.toString(QStringLiteral("yyyyMMdd'T'HHmmss'Z'")).toLatin1();
+        const int kind = mRandom.bounded(100);
+        if (kind < 85) {
+            const QByteArray dtEnd = start.addSecs(3600).toString(QStringLiteral("yyyyMMdd'T'HHmmss'Z'")).toLatin1();
+            data += "BEGIN:VEVENT\r\nUID:event-" + QByteArray::number(i) + "\r\nDTSTART:" + dtStart + "\r\nDTEND:" + dtEnd + "\r\nSUMMARY:Event "
+                + QByteArray::number(i) + "\r\nDESCRIPTION:Description of event " + QByteArray::number(i) + "\r\n";
+            if (kind < 15) {
+                data += QByteArray("RRULE:") + rules[kind % 4] + "\r\n";
+            }
+            data += "END:VEVENT\r\n";
+        } else {
+            data += "BEGIN:VTODO\r\nUID:todo-" + QByteArray::number(i) + "\r\nDUE:" + dtStart + "\r\nSUMMARY:To-do " + QByteArray::number(i)
+                + "\r\nSTATUS:NEEDS ACTION\r\nEND:VTODO\r\n";
+        }
+    }
+    data += "END:VCALENDAR\r\n";
+    return data;
+}
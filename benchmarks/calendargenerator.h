@@ -0,0 +1,68 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef CALENDARGENERATOR_H
+#define CALENDARGENERATOR_H
+
+#include "memorycalendar.h"
+
+#include <QRandomGenerator>
+
+/**
+  Generates synthetic calendars for the benchmarks.
+
+  The incidences are spread over two years from firstDate(), with a mix close
+  to real calendars: mostly single events, a sixth of recurring events of
+  various kinds (some with exceptions), to-dos and journals, part of them with
+  alarms, attendees or categories. The same seed always gives the same calendar.
+*/
+class CalendarGenerator
+{
+public:
+    explicit CalendarGenerator(quint32 seed = 1);
+
+    /**
+      Returns a calendar of about @p count incidences, in the Europe/Berlin
+      time zone.
+    */
+    KCalendarCore::MemoryCalendar::Ptr calendar(int count);
+
+    /**
+      Returns a vCalendar 1.0 document of @p count events and to-dos, since
+      VCalFormat cannot write one.
+    */
+    QByteArray vCalendar(int count);
+
+    /**
+      Returns the first day of the generated incidences.
+    */
+    static QDate firstDate();
+
+    /**
+      Adds an int "count" column to the current benchmark, with one row for
+      each calendar size to measure.
+
+      The sizes are read from the comma separated KCALCORE_BENCHMARK_SIZES
+      environment variable, e.g. "1000,10000,1000000", and default to 1000
+      and 10000 incidences.
+    */
+    static void addSizes();
+
+private:
+    KCalendarCore::Event::Ptr event(const QTimeZone &zone);
+    void makeRecurring(const KCalendarCore::Event::Ptr &event);
+    KCalendarCore::Todo::Ptr todo(const QTimeZone &zone);
+    KCalendarCore::Journal::Ptr journal(const QTimeZone &zone);
+    void addDetails(const KCalendarCore::Incidence::Ptr &incidence);
+    QDateTime randomStart(const QTimeZone &zone);
+
+    QRandomGenerator mRandom;
+    int mSerial = 0;
+};
+
+#endif
@@ -26,18 +26,24 @@
 #include "calendar_p.h"
 #include "calfilter.h"
 #include "icaltimezones_p.h"
-#include "sorting.h"
 #include "visitor.h"
 
 #include "kcalendarcore_debug.h"
 
+#include <QThread>
+#include <QThreadPool>
+
 
 extern "C" {
 #include <libical/icaltimezone.h>
 }
 
 #include <algorithm>
+#include <limits>
 #include <set>
+#include <string>
+#include <tuple>
+#include <vector>
 
 using namespace KCalendarCore;
 
@@ -230,7 +236,14 @@ CalFilter *Calendar::filter() const
 
 QStringList Calendar::categories() const
 {
-    const Incidence::List rawInc = rawIncidences();
+    CategoriesHookData data;
+    const_cast<Calendar *>(this)->virtual_hook(CategoriesHook, &data);
+    if (data.handled) {
+        return data.categories;
+    }
+
+    // Any order will do, so skip the sorting of rawIncidences()
+    const Incidence::List rawInc = mergeIncidenceList(rawEvents(), rawTodos(), rawJournals());
     QStringList uniqueCategories;
     QStringList thisCats;
     // @TODO: For now just iterate over all incidences. In the future,
@@ -248,17 +261,17 @@ QStringList Calendar::categories() const
 
 Incidence::List Calendar::incidences(const QDate &date) const
 {
-    return mergeIncidenceList(events(date), todos(date), journals(date));
+    return mergeIncidenceList(events(date), todos(date), journals(date), SortDirectionAscending);
 }
 
 Incidence::List Calendar::incidences() const
 {
-    return mergeIncidenceList(events(), todos(), journals());
+    return mergeIncidenceList(events(), todos(), journals(), SortDirectionAscending);
 }
 
 Incidence::List Calendar::rawIncidences() const
 {
-    return mergeIncidenceList(rawEvents(), rawTodos(), rawJournals());
+    return mergeIncidenceList(rawEvents(), rawTodos(), rawJournals(), SortDirectionAscending);
 }
 
 Incidence::List Calendar::instances(const Incidence::Ptr &incidence) const
@@ -281,6 +294,164 @@ Incidence::List Calendar::instances(const Incidence::Ptr &incidence) const
     }
 }
 
+//@cond PRIVATE
+/**
+  Sort key computed once for each item by sortEvents(), sortTodos() and
+  sortJournals(), so that comparisons don't convert date/times or fold the
+  case of summaries again. Keys compare field by field, in the order of the
+  comparison functions of sorting.h; the fields a sort field doesn't use are
+  left empty.
+*/
+struct SortKey {
+    qint64 start = 0; // UTC milliseconds, or priority or percentage
+    qint64 end = 0; // end of the day of all-day dates, else start
+    QString text; // categories
+    std::u32string summary; // case folded
+};
+
+static bool operator<(const SortKey &key1, const SortKey &key2)
+{
+    return std::tie(key1.start, key1.end, key1.text, key1.summary) < std::tie(key2.start, key2.end, key2.text, key2.summary);
+}
+
+// An all-day date/time is compared as the period to the end of its day, in
+// its own time zone. Invalid date/times come first.
+static void setDateKey(SortKey &key, const QDateTime &dt, bool allDay)
+{
+    if (!dt.isValid()) {
+        key.start = key.end = std::numeric_limits<qint64>::min();
+        return;
+    }
+    key.start = dt.toMSecsSinceEpoch();
+    key.end = allDay ? QDateTime(dt.date(), QTime(23, 59, 59, 999), dt.timeRepresentation()).toMSecsSinceEpoch() : key.start;
+}
+
+// Code points folded as QString::compare(Qt::CaseInsensitive) does.
+static std::u32string summaryKey(const QString &summary)
+{
+    const QList<uint> ucs4 = summary.toUcs4();
+    std::u32string key;
+    key.reserve(ucs4.size());
+    for (uint c : ucs4) {
+        key += QChar::toCaseFolded(char32_t(c));
+    }
+    return key;
+}
+
+// Lists of at least this many items are sorted by several threads.
+static const qsizetype parallelSortThreshold = 16384;
+
+// Calls function(first, last) for contiguous slices covering [0, count),
+// concurrently for long ranges, and returns the slice boundaries.
+template<typename SliceFunction>
+static std::vector<qsizetype> forEachSlice(qsizetype count, SliceFunction function)
+{
+    int threadCount = 1;
+    if (count >= parallelSortThreshold) {
+        threadCount = int(std::clamp<qsizetype>(count / (parallelSortThreshold / 4), 1, std::max(1, QThread::idealThreadCount())));
+    }
+    std::vector<qsizetype> bounds;
+    bounds.reserve(threadCount + 1);
+    for (int w = 0; w <= threadCount; ++w) {
+        bounds.push_back(count * w / threadCount);
+    }
+    if (threadCount == 1) {
+        function(qsizetype(0), count);
+        return bounds;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    for (int w = 0; w < threadCount; ++w) {
+        const qsizetype first = bounds[w];
+        const qsizetype last = bounds[w + 1];
+        pool.start([&function, first, last]() {
+            function(first, last);
+        });
+    }
+    pool.waitForDone();
+    return bounds;
+}
+
+// Merges the sorted runs of @p order delimited by @p bounds, pairwise and
+// concurrently, until a single sorted run is left.
+template<typename LessThan>
+static void mergeRuns(std::vector<qsizetype> &order, std::vector<qsizetype> bounds, LessThan lessThan)
+{
+    while (bounds.size() > 2) {
+        const size_t runCount = bounds.size() - 1;
+        std::vector<qsizetype> merged;
+        merged.reserve(runCount / 2 + 2);
+        QThreadPool pool;
+        pool.setMaxThreadCount(std::max<int>(1, runCount / 2));
+        for (size_t r = 0; r + 1 < runCount; r += 2) {
+            const auto first = order.begin() + bounds[r];
+            const auto middle = order.begin() + bounds[r + 1];
+            const auto last = order.begin() + bounds[r + 2];
+            if (runCount == 2) {
+                std::inplace_merge(first, middle, last, lessThan);
+            } else {
+                pool.start([first, middle, last, &lessThan]() {
+                    std::inplace_merge(first, middle, last, lessThan);
+                });
+            }
+            merged.push_back(bounds[r]);
+        }
+        if (runCount % 2) {
+            merged.push_back(bounds[runCount - 1]);
+        }
+        merged.push_back(bounds.back());
+        pool.waitForDone();
+        bounds = std::move(merged);
+    }
+}
+
+template<typename T, typename KeyFunction>
+static std::vector<SortKey> sortKeys(const QList<T> &list, KeyFunction setKey)
+{
+    std::vector<SortKey> keys(list.size());
+    forEachSlice(list.size(), [&list, &keys, &setKey](qsizetype first, qsizetype last) {
+        for (qsizetype i = first; i < last; ++i) {
+            setKey(list.at(i), keys[i]);
+        }
+    });
+    return keys;
+}
+
+template<typename T>
+static QList<T> reordered(QList<T> &&list, const std::vector<qsizetype> &order)
+{
+    QList<T> sorted;
+    sorted.reserve(list.size());
+    for (qsizetype i : order) {
+        sorted.append(std::move(list[i]));
+    }
+    return sorted;
+}
+
+// Long lists are sorted in slices by several threads, and the sorted slices
+// are then merged.
+template<typename T, typename KeyFunction>
+static QList<T> sortByKey(QList<T> &&list, SortDirection sortDirection, KeyFunction setKey)
+{
+    const std::vector<SortKey> keys = sortKeys(list, setKey);
+    const auto lessThan = [&keys, sortDirection](qsizetype i1, qsizetype i2) {
+        return sortDirection == SortDirectionAscending ? keys[i1] < keys[i2] : keys[i2] < keys[i1];
+    };
+
+    std::vector<qsizetype> order(list.size());
+    const std::vector<qsizetype> bounds = forEachSlice(list.size(), [&order, &lessThan](qsizetype first, qsizetype last) {
+        for (qsizetype i = first; i < last; ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin() + first, order.begin() + last, lessThan);
+    });
+    mergeRuns(order, bounds, lessThan);
+
+    return reordered(std::move(list), order);
+}
+//@endcond
+
 Event::List Calendar::sortEvents(Event::List &&eventList, EventSortField sortField, SortDirection sortDirection)
 {
     switch (sortField) {
@@ -288,28 +459,21 @@ Event::List Calendar::sortEvents(Event::List &&eventList, EventSortField sortFie
         break;
 
     case EventSortStartDate:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(eventList.begin(), eventList.end(), Events::startDateLessThan);
-        } else {
-            std::sort(eventList.begin(), eventList.end(), Events::startDateMoreThan);
-        }
-        break;
+        return sortByKey(std::move(eventList), sortDirection, [](const Event::Ptr &event, SortKey &key) {
+            setDateKey(key, event->dtStart(), event->allDay());
+            key.summary = summaryKey(event->summary());
+        });
 
     case EventSortEndDate:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(eventList.begin(), eventList.end(), Events::endDateLessThan);
-        } else {
-            std::sort(eventList.begin(), eventList.end(), Events::endDateMoreThan);
-        }
-        break;
+        return sortByKey(std::move(eventList), sortDirection, [](const Event::Ptr &event, SortKey &key) {
+            setDateKey(key, event->dtEnd(), event->allDay());
+            key.summary = summaryKey(event->summary());
+        });
 
     case EventSortSummary:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(eventList.begin(), eventList.end(), Events::summaryLessThan);
-        } else {
-            std::sort(eventList.begin(), eventList.end(), Events::summaryMoreThan);
-        }
-        break;
+        return sortByKey(std::move(eventList), sortDirection, [](const Event::Ptr &event, SortKey &key) {
+            key.summary = summaryKey(event->summary());
+        });
     }
 
     return eventList;
@@ -420,10 +584,89 @@ Incidence::Ptr Calendar::incidence(const QString &uid, const QDateTime &recurren
     return i;
 }
 
+// Appends the occurrences of incidences[first] to incidences[last - 1] to @p result.
+static void expandOccurrences(const Incidence::List &incidences, int first, int last, const QDateTime &start, const QDateTime &end, Calendar::OccurrenceArrays &result)
+{
+    for (int i = first; i < last; ++i) {
+        const Incidence::Ptr &incidence = incidences.at(i);
+        QDateTime dtStart = incidence->dtStart();
+        if (!dtStart.isValid() && incidence->type() == Incidence::TypeTodo) {
+            // To-dos without a start date occur at their due date.
+            dtStart = incidence.staticCast<Todo>()->dtDue();
+        }
+        QDateTime dtEnd = incidence->hasDuration() ? incidence->duration().end(dtStart) : incidence->dateTime(Incidence::RoleEnd);
+        if (incidence->allDay() && dtEnd.isValid()) {
+            // The end date of all-day incidences is inclusive.
+            dtEnd = QDateTime(dtEnd.date().addDays(1), QTime(0, 0), dtStart.timeZone());
+        }
+        const qint64 duration = dtStart.isValid() && dtEnd.isValid() ? std::max<qint64>(0, dtStart.secsTo(dtEnd)) : 0;
+
+        if (incidence->recurs()) {
+            const auto times = incidence->recurrence()->timesInInterval(start, end);
+            for (const QDateTime &dt : times) {
+                result.starts.append(dt.toSecsSinceEpoch());
+                result.durations.append(duration);
+                result.incidenceIndexes.append(i);
+            }
+        } else if (dtStart.isValid() && dtStart >= start && dtStart <= end) {
+            result.starts.append(dtStart.toSecsSinceEpoch());
+            result.durations.append(duration);
+            result.incidenceIndexes.append(i);
+        }
+    }
+}
+
+Calendar::OccurrenceArrays Calendar::expandOccurrences(const QDateTime &start, const QDateTime &end, const Incidence::List &incidences, int threadCount) const
+{
+    OccurrenceArrays result;
+    result.incidences = incidences.isEmpty() ? rawIncidences() : incidences;
+    const int count = result.incidences.size();
+
+    // Below a few dozen incidences per thread, threads cost more than they save.
+    if (threadCount <= 0) {
+        threadCount = QThread::idealThreadCount();
+    }
+    threadCount = std::max(1, std::min(threadCount, count / 32));
+    if (threadCount == 1) {
+        ::expandOccurrences(result.incidences, 0, count, start, end, result);
+        return result;
+    }
+
+    // Each thread expands a contiguous slice, then the slices are concatenated
+    // in order.
+    std::vector<OccurrenceArrays> slices(threadCount);
+    const int sliceSize = (count + threadCount - 1) / threadCount;
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    for (int w = 0; w < threadCount; ++w) {
+        const int first = w * sliceSize;
+        const int last = std::min(first + sliceSize, count);
+        OccurrenceArrays *slice = &slices[w];
+        pool.start([&result, &start, &end, first, last, slice]() {
+            ::expandOccurrences(result.incidences, first, last, start, end, *slice);
+        });
+    }
+    pool.waitForDone();
+
+    qsizetype total = 0;
+    for (const OccurrenceArrays &slice : slices) {
+        total += slice.starts.size();
+    }
+    result.starts.reserve(total);
+    result.durations.reserve(total);
+    result.incidenceIndexes.reserve(total);
+    for (const OccurrenceArrays &slice : slices) {
+        result.starts.append(slice.starts);
+        result.durations.append(slice.durations);
+        result.incidenceIndexes.append(slice.incidenceIndexes);
+    }
+    return result;
+}
+
 Incidence::List Calendar::incidencesFromSchedulingID(const QString &sid) const
 {
     Incidence::List result;
-    const Incidence::List incidences = rawIncidences();
+    const Incidence::List incidences = mergeIncidenceList(rawEvents(), rawTodos(), rawJournals());
     std::copy_if(incidences.cbegin(), incidences.cend(), std::back_inserter(result), [&sid](const Incidence::Ptr &in) {
         return in->schedulingID() == sid;
     });
@@ -432,7 +675,7 @@ Incidence::List Calendar::incidencesFromSchedulingID(const QString &sid) const
 
 Incidence::Ptr Calendar::incidenceFromSchedulingID(const QString &uid) const
 {
-    const Incidence::List incidences = rawIncidences();
+    const Incidence::List incidences = mergeIncidenceList(rawEvents(), rawTodos(), rawJournals());
     const auto itEnd = incidences.cend();
     auto it = std::find_if(incidences.cbegin(), itEnd, [&uid](const Incidence::Ptr &in) {
         return in->schedulingID() == uid;
@@ -449,60 +692,50 @@ Todo::List Calendar::sortTodos(Todo::List &&todoList, TodoSortField sortField, S
         break;
 
     case TodoSortStartDate:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(todoList.begin(), todoList.end(), Todos::startDateLessThan);
-        } else {
-            std::sort(todoList.begin(), todoList.end(), Todos::startDateMoreThan);
-        }
-        break;
+        return sortByKey(std::move(todoList), sortDirection, [](const Todo::Ptr &todo, SortKey &key) {
+            setDateKey(key, todo->dtStart(), todo->allDay());
+            key.summary = summaryKey(todo->summary());
+        });
 
     case TodoSortDueDate:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(todoList.begin(), todoList.end(), Todos::dueDateLessThan);
-        } else {
-            std::sort(todoList.begin(), todoList.end(), Todos::dueDateMoreThan);
-        }
-        break;
+        // To-dos without a due date come last, in no particular order
+        return sortByKey(std::move(todoList), sortDirection, [](const Todo::Ptr &todo, SortKey &key) {
+            if (todo->hasDueDate()) {
+                setDateKey(key, todo->dtDue(), todo->allDay());
+                key.summary = summaryKey(todo->summary());
+            } else {
+                key.start = key.end = std::numeric_limits<qint64>::max();
+            }
+        });
 
     case TodoSortPriority:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(todoList.begin(), todoList.end(), Todos::priorityLessThan);
-        } else {
-            std::sort(todoList.begin(), todoList.end(), Todos::priorityMoreThan);
-        }
-        break;
+        return sortByKey(std::move(todoList), sortDirection, [](const Todo::Ptr &todo, SortKey &key) {
+            key.start = todo->priority();
+            key.summary = summaryKey(todo->summary());
+        });
 
     case TodoSortPercentComplete:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(todoList.begin(), todoList.end(), Todos::percentLessThan);
-        } else {
-            std::sort(todoList.begin(), todoList.end(), Todos::percentMoreThan);
-        }
-        break;
+        return sortByKey(std::move(todoList), sortDirection, [](const Todo::Ptr &todo, SortKey &key) {
+            key.start = todo->percentComplete();
+            key.summary = summaryKey(todo->summary());
+        });
 
     case TodoSortSummary:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(todoList.begin(), todoList.end(), Todos::summaryLessThan);
-        } else {
-            std::sort(todoList.begin(), todoList.end(), Todos::summaryMoreThan);
-        }
-        break;
+        return sortByKey(std::move(todoList), sortDirection, [](const Todo::Ptr &todo, SortKey &key) {
+            key.summary = summaryKey(todo->summary());
+        });
 
     case TodoSortCreated:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(todoList.begin(), todoList.end(), Todos::createdLessThan);
-        } else {
-            std::sort(todoList.begin(), todoList.end(), Todos::createdMoreThan);
-        }
-        break;
+        return sortByKey(std::move(todoList), sortDirection, [](const Todo::Ptr &todo, SortKey &key) {
+            setDateKey(key, todo->created(), todo->allDay());
+            key.summary = summaryKey(todo->summary());
+        });
 
     case TodoSortCategories:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(todoList.begin(), todoList.end(), Incidences::categoriesLessThan);
-        } else {
-            std::sort(todoList.begin(), todoList.end(), Incidences::categoriesMoreThan);
-        }
-        break;
+        return sortByKey(std::move(todoList), sortDirection, [](const Todo::Ptr &todo, SortKey &key) {
+            key.text = todo->categoriesStr();
+            key.summary = summaryKey(todo->summary());
+        });
     }
 
     return todoList;
@@ -536,20 +769,14 @@ Journal::List Calendar::sortJournals(Journal::List &&journalList, JournalSortFie
         break;
 
     case JournalSortDate:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(journalList.begin(), journalList.end(), Journals::dateLessThan);
-        } else {
-            std::sort(journalList.begin(), journalList.end(), Journals::dateMoreThan);
-        }
-        break;
+        return sortByKey(std::move(journalList), sortDirection, [](const Journal::Ptr &journal, SortKey &key) {
+            setDateKey(key, journal->dtStart(), journal->allDay());
+        });
 
     case JournalSortSummary:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(journalList.begin(), journalList.end(), Journals::summaryLessThan);
-        } else {
-            std::sort(journalList.begin(), journalList.end(), Journals::summaryMoreThan);
-        }
-        break;
+        return sortByKey(std::move(journalList), sortDirection, [](const Journal::Ptr &journal, SortKey &key) {
+            key.summary = summaryKey(journal->summary());
+        });
     }
 
     return journalList;
@@ -788,6 +1015,35 @@ Incidence::List Calendar::mergeIncidenceList(const Event::List &events, const To
     return incidences;
 }
 
+Incidence::List Calendar::mergeIncidenceList(const Event::List &events, const Todo::List &todos, const Journal::List &journals, SortDirection sortDirection)
+{
+    Incidence::List incidences = mergeIncidenceList(events, todos, journals);
+    const std::vector<SortKey> keys = sortKeys(incidences, [](const Incidence::Ptr &incidence, SortKey &key) {
+        setDateKey(key, incidence->dateTime(Incidence::RoleSort), incidence->allDay());
+        key.summary = summaryKey(incidence->summary());
+    });
+    const auto lessThan = [&keys, sortDirection](qsizetype i1, qsizetype i2) {
+        return sortDirection == SortDirectionAscending ? keys[i1] < keys[i2] : keys[i2] < keys[i1];
+    };
+
+    // Each list is one run, only sorted if it isn't in order already.
+    std::vector<qsizetype> order(incidences.size());
+    for (qsizetype i = 0; i < incidences.size(); ++i) {
+        order[i] = i;
+    }
+    const std::vector<qsizetype> bounds = {0, events.size(), events.size() + todos.size(), incidences.size()};
+    for (size_t r = 0; r + 1 < bounds.size(); ++r) {
+        const auto first = order.begin() + bounds[r];
+        const auto last = order.begin() + bounds[r + 1];
+        if (!std::is_sorted(first, last, lessThan)) {
+            std::sort(first, last, lessThan);
+        }
+    }
+    mergeRuns(order, bounds, lessThan);
+
+    return reordered(std::move(incidences), order);
+}
+
 bool Calendar::beginChange(const Incidence::Ptr &incidence)
 {
     Q_UNUSED(incidence);
@@ -942,9 +1198,10 @@ Alarm::List Calendar::alarmsTo(const QDateTime &to) const
 
 void Calendar::virtual_hook(int id, void *data)
 {
+    // Hooks not handled by a subclass leave their data unchanged, and the
+    // caller falls back to its own implementation.
     Q_UNUSED(id);
     Q_UNUSED(data);
-    Q_ASSERT(false);
 }
 
 QString Calendar::id() const
@@ -399,6 +399,9 @@ public:
     /**
       Returns a filtered list of all Incidences for this Calendar.
 
+      The Incidences are ordered by date and summary, as
+      Incidences::dateLessThan() orders them.
+
       @return the list of all filtered Incidences.
     */
     virtual Incidence::List incidences() const;
@@ -406,6 +409,9 @@ public:
     /**
       Returns a filtered list of all Incidences which occur on the given date.
 
+      The Incidences are ordered by date and summary, as
+      Incidences::dateLessThan() orders them.
+
       @param date request filtered Incidence list for this QDate only.
 
       @return the list of filtered Incidences occurring on the specified date.
@@ -415,6 +421,9 @@ public:
     /**
       Returns an unfiltered list of all Incidences for this Calendar.
 
+      The Incidences are ordered by date and summary, as
+      Incidences::dateLessThan() orders them.
+
       @return the list of all unfiltered Incidences.
     */
     virtual Incidence::List rawIncidences() const;
@@ -428,6 +437,44 @@ public:
     */
     virtual Incidence::List instances(const Incidence::Ptr &incidence) const;
 
+    /**
+      Occurrences of a set of incidences, as returned by expandOccurrences().
+
+      The occurrences are stored as parallel arrays: occurrence i starts at
+      starts[i], in seconds since the epoch, lasts durations[i] seconds and
+      belongs to incidences[incidenceIndexes[i]].
+      @since 6.0
+    */
+    struct OccurrenceArrays {
+        Incidence::List incidences;
+        QList<qint64> starts;
+        QList<qint64> durations;
+        QList<int> incidenceIndexes;
+    };
+
+    /**
+      Expands the occurrences of many incidences at once.
+
+      For recurring incidences, these are the times returned by
+      Recurrence::timesInInterval(), without applying the exceptions of the
+      recurrence, which are listed as incidences of their own. A non-recurring
+      incidence has one occurrence at its start, or at its due date for a
+      to-do without a start date. Each occurrence lasts as long as its
+      incidence, all-day incidences lasting whole days.
+
+      The occurrences are grouped by incidence, in the order of @p incidences.
+
+      @param start the start of the interval, inclusive.
+      @param end the end of the interval, inclusive.
+      @param incidences the incidences to expand, or all the unfiltered
+      incidences of the calendar if empty.
+      @param threadCount the number of threads to share the work between,
+      or 0 to use QThread::idealThreadCount().
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT OccurrenceArrays
+    expandOccurrences(const QDateTime &start, const QDateTime &end, const Incidence::List &incidences = {}, int threadCount = 1) const;
+
     /**
       Returns the Incidence associated with the given unique identifier.
 
@@ -476,6 +523,24 @@ public:
     */
     static Incidence::List mergeIncidenceList(const Event::List &events, const Todo::List &todos, const Journal::List &journals);
 
+    /**
+      Create a merged list of Events, Todos, and Journals, ordered by date and
+      summary as Incidences::dateLessThan() orders them, or as
+      Incidences::dateMoreThan() does for a descending @p sortDirection.
+
+      Lists which are already in that order, like events sorted by
+      EventSortStartDate, are merged without sorting them again.
+
+      @param events is an Event list to merge.
+      @param todos is a Todo list to merge.
+      @param journals is a Journal list to merge.
+      @param sortDirection specifies the order of the merged list.
+
+      @return a list of merged Incidences.
+      @since 6.0
+    */
+    static Incidence::List mergeIncidenceList(const Event::List &events, const Todo::List &todos, const Journal::List &journals, SortDirection sortDirection);
+
     /**
       Flag that a change to a Calendar Incidence is starting.
       @param incidence is a pointer to the Incidence that will be changing.
@@ -69,6 +69,21 @@ public:
     AccessMode mAccessMode = ReadWrite;
 };
 
+/**
+  Ids of the virtual_hook() calls made by Calendar, through which subclasses
+  can answer more methods without adding virtual methods to Calendar. A
+  calendar that doesn't handle a hook leaves its data unchanged.
+  @internal
+*/
+enum CalendarVirtualHook {
+    CategoriesHook = 1, // data is a CategoriesHookData, for categories()
+};
+
+struct CategoriesHookData {
+    QStringList categories;
+    bool handled = false;
+};
+
 }
 
 #endif
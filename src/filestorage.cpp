@@ -16,50 +16,312 @@
   @author Cornelius Schumacher \<schumacher@kde.org\>
 */
 #include "filestorage.h"
+#include "event.h"
 #include "exceptions.h"
 #include "icalformat.h"
+#include "journal.h"
 #include "memorycalendar.h"
+#include "todo.h"
 #include "vcalformat.h"
 
 #include "kcalendarcore_debug.h"
 
+#include <QDataStream>
+#include <QFile>
+#include <QScopedValueRollback>
+#include <QThread>
+
 using namespace KCalendarCore;
 
+// Magic number ("KCJL") and version of the journal entries.
+#define KCALCORE_JOURNAL_MAGIC 0x4B434A4C
+#define KCALCORE_JOURNAL_VERSION 1
+
 /*
   Private class that helps to provide binary compatibility between releases.
 */
 //@cond PRIVATE
-class Q_DECL_HIDDEN KCalendarCore::FileStorage::Private
+class Q_DECL_HIDDEN KCalendarCore::FileStorage::Private : public Calendar::CalendarObserver
 {
 public:
+    enum Operation : quint8 {
+        Store,
+        Remove,
+    };
+
+    struct Change {
+        Operation operation;
+        QString uid;
+        QDateTime recurrenceId;
+        Incidence::Ptr incidence;
+    };
+
     Private(const QString &fileName, CalFormat *format)
         : mFileName(fileName)
         , mSaveFormat(format)
     {
     }
-    ~Private()
+    ~Private() override
     {
+        waitForCompaction();
         delete mSaveFormat;
     }
 
+    void calendarIncidenceAdded(const Incidence::Ptr &incidence) override
+    {
+        recordChange(Store, incidence);
+    }
+    void calendarIncidenceChanged(const Incidence::Ptr &incidence) override
+    {
+        recordChange(Store, incidence);
+    }
+    void calendarIncidenceDeleted(const Incidence::Ptr &incidence, const Calendar *calendar) override
+    {
+        Q_UNUSED(calendar);
+        recordChange(Remove, incidence);
+    }
+
+    void recordChange(Operation operation, const Incidence::Ptr &incidence);
+    bool appendJournal(const QString &fileName);
+    int replayJournal(const Calendar::Ptr &calendar, const QString &fileName);
+    void startCompaction(const Calendar::Ptr &calendar);
+    bool waitForCompaction();
+    void removeJournals();
+
+    QString compactingJournalFileName() const
+    {
+        return mFileName + QLatin1String(".journal.compacting");
+    }
+
     QString mFileName;
     CalFormat *mSaveFormat = nullptr;
+
+    bool mJournaled = false;
+    bool mFullSaveNeeded = false;
+    bool mLoading = false;
+    int mCompactionThreshold = 1000;
+    int mJournalEntries = 0;
+    // Changes not yet written, keyed on Incidence::instanceIdentifier().
+    QHash<QString, Change> mChanges;
+    QThread *mCompaction = nullptr;
+    bool mCompactionSucceeded = false;
 };
+
+void FileStorage::Private::recordChange(Operation operation, const Incidence::Ptr &incidence)
+{
+    if (!mJournaled || mLoading) {
+        return;
+    }
+    mChanges.insert(incidence->instanceIdentifier(), {operation, incidence->uid(), incidence->recurrenceId(), operation == Store ? incidence : Incidence::Ptr()});
+}
+
+bool FileStorage::Private::appendJournal(const QString &fileName)
+{
+    if (mChanges.isEmpty()) {
+        return true;
+    }
+
+    // All the changes are written as a single entry so that an interrupted
+    // write only loses this save, which replayJournal() then ignores.
+    QByteArray entry;
+    QDataStream out(&entry, QIODevice::WriteOnly);
+    out << quint32(mChanges.size());
+    for (const Change &change : std::as_const(mChanges)) {
+        out << quint8(change.operation) << change.uid << change.recurrenceId;
+        if (change.operation == Store) {
+            QByteArray record;
+            QDataStream recordStream(&record, QIODevice::WriteOnly);
+            recordStream << change.incidence.staticCast<IncidenceBase>();
+            out << qint32(change.incidence->type()) << record;
+        }
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qCWarning(KCALCORE_LOG) << "Unable to open journal" << fileName << file.errorString();
+        return false;
+    }
+    QDataStream stream(&file);
+    stream << quint32(KCALCORE_JOURNAL_MAGIC) << quint32(KCALCORE_JOURNAL_VERSION) << qint32(out.version()) << entry;
+    if (stream.status() != QDataStream::Ok || !file.flush()) {
+        qCWarning(KCALCORE_LOG) << "Unable to write journal" << fileName << file.errorString();
+        return false;
+    }
+
+    mJournalEntries += mChanges.size();
+    mChanges.clear();
+    return true;
+}
+
+int FileStorage::Private::replayJournal(const Calendar::Ptr &calendar, const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    int entries = 0;
+    QDataStream stream(&file);
+    while (!stream.atEnd()) {
+        quint32 magic;
+        quint32 version;
+        qint32 streamVersion;
+        QByteArray entry;
+        stream >> magic >> version >> streamVersion >> entry;
+        if (stream.status() != QDataStream::Ok || magic != KCALCORE_JOURNAL_MAGIC || version > KCALCORE_JOURNAL_VERSION || streamVersion > stream.version()) {
+            qCWarning(KCALCORE_LOG) << "Ignoring the end of journal" << fileName;
+            break;
+        }
+
+        QDataStream in(entry);
+        in.setVersion(streamVersion);
+        quint32 count;
+        in >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            quint8 operation;
+            QString uid;
+            QDateTime recurrenceId;
+            in >> operation >> uid >> recurrenceId;
+
+            IncidenceBase::Ptr incidence;
+            if (operation == Store) {
+                qint32 type;
+                QByteArray record;
+                in >> type >> record;
+                switch (type) {
+                case IncidenceBase::TypeEvent:
+                    incidence = Event::Ptr(new Event);
+                    break;
+                case IncidenceBase::TypeTodo:
+                    incidence = Todo::Ptr(new Todo);
+                    break;
+                case IncidenceBase::TypeJournal:
+                    incidence = Journal::Ptr(new Journal);
+                    break;
+                default:
+                    continue;
+                }
+                QDataStream recordStream(record);
+                recordStream.setVersion(streamVersion);
+                recordStream >> incidence;
+                if (recordStream.status() != QDataStream::Ok) {
+                    continue;
+                }
+            }
+
+            Incidence::List instances;
+            const Incidence::Ptr existing = calendar->incidence(uid, recurrenceId);
+            if (existing) {
+                // Deleting a recurring incidence also deletes its exceptions,
+                // which are only journaled separately when they change.
+                if (incidence && !existing->hasRecurrenceId()) {
+                    instances = calendar->instances(existing);
+                }
+                calendar->deleteIncidence(existing);
+            }
+            if (incidence) {
+                calendar->addIncidence(incidence.staticCast<Incidence>());
+                for (const Incidence::Ptr &instance : std::as_const(instances)) {
+                    calendar->addIncidence(instance);
+                }
+            }
+            ++entries;
+        }
+    }
+    return entries;
+}
+
+void FileStorage::Private::startCompaction(const Calendar::Ptr &calendar)
+{
+    // The journal written so far is set aside: it stays valid until the new
+    // calendar file has been written, while later saves start a new journal.
+    const QString journal = mFileName + QLatin1String(".journal");
+    if (QFile::exists(compactingJournalFileName())) {
+        // A previous compaction failed: its journal is still needed.
+        QFile source(journal);
+        QFile target(compactingJournalFileName());
+        if (!source.open(QIODevice::ReadOnly) || !target.open(QIODevice::WriteOnly | QIODevice::Append) || target.write(source.readAll()) < 0
+            || !target.flush()) {
+            qCWarning(KCALCORE_LOG) << "Unable to rotate journal" << journal;
+            return;
+        }
+        source.remove();
+    } else if (!QFile::rename(journal, compactingJournalFileName())) {
+        qCWarning(KCALCORE_LOG) << "Unable to rotate journal" << journal;
+        return;
+    }
+    mJournalEntries = 0;
+
+    // Copy the calendar state, the calendar itself may change during compaction.
+    Incidence::List incidences;
+    const Incidence::List rawIncidences = calendar->rawIncidences();
+    incidences.reserve(rawIncidences.size());
+    for (const Incidence::Ptr &incidence : rawIncidences) {
+        incidences.append(Incidence::Ptr(incidence->clone()));
+    }
+    const QTimeZone timeZone = calendar->timeZone();
+    const QString productId = calendar->productId();
+    const QMap<QByteArray, QString> properties = calendar->customProperties();
+    const QString fileName = mFileName;
+    const QString compactingJournal = compactingJournalFileName();
+    CalFormat *format = mSaveFormat;
+
+    mCompactionSucceeded = false;
+    mCompaction = QThread::create([this, incidences, timeZone, productId, properties, fileName, compactingJournal, format]() {
+        MemoryCalendar::Ptr snapshot(new MemoryCalendar(timeZone));
+        snapshot->setProductId(productId);
+        snapshot->setCustomProperties(properties);
+        for (const Incidence::Ptr &incidence : incidences) {
+            snapshot->addIncidence(incidence);
+        }
+        ICalFormat iCal;
+        if ((format ? format : &iCal)->save(snapshot, fileName)) {
+            QFile::remove(compactingJournal);
+            mCompactionSucceeded = true;
+        }
+    });
+    mCompaction->start();
+}
+
+bool FileStorage::Private::waitForCompaction()
+{
+    if (!mCompaction) {
+        return true;
+    }
+    mCompaction->wait();
+    delete mCompaction;
+    mCompaction = nullptr;
+    if (!mCompactionSucceeded) {
+        qCWarning(KCALCORE_LOG) << "Compaction of" << mFileName << "failed, keeping its journal";
+    }
+    return mCompactionSucceeded;
+}
+
+void FileStorage::Private::removeJournals()
+{
+    QFile::remove(mFileName + QLatin1String(".journal"));
+    QFile::remove(compactingJournalFileName());
+    mJournalEntries = 0;
+    mChanges.clear();
+}
 //@endcond
 
 FileStorage::FileStorage(const Calendar::Ptr &cal, const QString &fileName, CalFormat *format)
     : CalStorage(cal)
     , d(new Private(fileName, format))
 {
+    cal->registerObserver(d);
 }
 
 FileStorage::~FileStorage()
 {
+    calendar()->unregisterObserver(d);
     delete d;
 }
 
 void FileStorage::setFileName(const QString &fileName)
 {
+    d->waitForCompaction();
     d->mFileName = fileName;
 }
 
@@ -70,6 +332,7 @@ QString FileStorage::fileName() const
 
 void FileStorage::setSaveFormat(CalFormat *format)
 {
+    d->waitForCompaction();
     delete d->mSaveFormat;
     d->mSaveFormat = format;
 }
@@ -79,6 +342,34 @@ CalFormat *FileStorage::saveFormat() const
     return d->mSaveFormat;
 }
 
+void FileStorage::setJournaled(bool journaled)
+{
+    d->mJournaled = journaled;
+    // Changes made before were not recorded.
+    d->mFullSaveNeeded = journaled && calendar()->isModified();
+    d->mChanges.clear();
+}
+
+bool FileStorage::journaled() const
+{
+    return d->mJournaled;
+}
+
+QString FileStorage::journalFileName() const
+{
+    return d->mFileName + QLatin1String(".journal");
+}
+
+void FileStorage::setCompactionThreshold(int entries)
+{
+    d->mCompactionThreshold = entries;
+}
+
+int FileStorage::compactionThreshold() const
+{
+    return d->mCompactionThreshold;
+}
+
 bool FileStorage::open()
 {
     return true;
@@ -91,6 +382,10 @@ bool FileStorage::load()
         return false;
     }
 
+    d->waitForCompaction();
+    // Incidences added while loading are not changes to be journaled.
+    const QScopedValueRollback<bool> loading(d->mLoading, true);
+
     // Always try to load with iCalendar. It will detect, if it is actually a
     // vCalendar file.
     bool success;
@@ -133,6 +428,10 @@ bool FileStorage::load()
         }
     }
 
+    d->mJournalEntries = d->replayJournal(calendar(), d->compactingJournalFileName());
+    d->mJournalEntries += d->replayJournal(calendar(), journalFileName());
+    d->mChanges.clear();
+
     calendar()->setProductId(productId);
     calendar()->setModified(false);
 
@@ -145,11 +444,28 @@ bool FileStorage::save()
         return false;
     }
 
+    if (d->mJournaled && !d->mFullSaveNeeded && QFile::exists(d->mFileName)) {
+        if (!d->appendJournal(journalFileName())) {
+            return false;
+        }
+        calendar()->setModified(false);
+        if (d->mJournalEntries > d->mCompactionThreshold && !d->mCompaction) {
+            d->startCompaction(calendar());
+        } else if (d->mCompaction && d->mCompaction->isFinished()) {
+            d->waitForCompaction();
+        }
+        return true;
+    }
+
+    d->waitForCompaction();
+
     CalFormat *format = d->mSaveFormat ? d->mSaveFormat : new ICalFormat;
 
     bool success = format->save(calendar(), d->mFileName);
 
     if (success) {
+        d->removeJournals();
+        d->mFullSaveNeeded = false;
         calendar()->setModified(false);
     } else {
         if (!format->exception()) {
@@ -168,7 +484,7 @@ bool FileStorage::save()
 
 bool FileStorage::close()
 {
-    return true;
+    return d->waitForCompaction();
 }
 
 #include "moc_filestorage.cpp"
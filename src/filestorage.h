@@ -86,6 +86,57 @@ public:
     */
     CalFormat *saveFormat() const;
 
+    /**
+      Sets whether save() only records the changes made since the last save.
+
+      In journaled mode, the incidences added, changed or deleted in the
+      calendar are appended to a journal file next to the calendar file,
+      so that the cost of save() depends on the size of the changes rather
+      than on the size of the calendar. Once the journal holds more than
+      compactionThreshold() entries, the calendar file is rewritten in a
+      background thread and the journal is discarded.
+
+      Changes are tracked through the calendar observer notifications, so
+      changes made while they are disabled with Calendar::setObserversEnabled()
+      are not recorded. load() always applies the changes found in the
+      journal, whether journaled mode is enabled or not.
+
+      @param journaled whether to use journaled mode.
+      @see journalFileName(), setCompactionThreshold()
+      @since 6.0
+    */
+    void setJournaled(bool journaled);
+
+    /**
+      Returns whether save() only records the changes made since the last save.
+      @see setJournaled()
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT bool journaled() const;
+
+    /**
+      Returns the name of the journal file used in journaled mode.
+      @see setJournaled()
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT QString journalFileName() const;
+
+    /**
+      Sets the number of journal entries above which save() rewrites the
+      calendar file. The default is 1000.
+      @see setJournaled()
+      @since 6.0
+    */
+    void setCompactionThreshold(int entries);
+
+    /**
+      Returns the number of journal entries above which save() rewrites the
+      calendar file.
+      @see setCompactionThreshold()
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT int compactionThreshold() const;
+
     /**
       @copydoc CalStorage::open()
     */
@@ -25,8 +25,14 @@
 
 #include <QFile>
 #include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
 #include <QTimeZone>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 extern "C" {
 #include <libical/ical.h>
 #include <libical/icalmemory.h>
@@ -46,9 +52,213 @@ public:
         , mTimeZone(QTimeZone::utc())
     {
     }
+
+    bool loadComponents(ICalFormat *q, const Calendar::Ptr &calendar, QFile &file);
+    void addComponents(const Calendar::Ptr &calendar,
+                       const QList<QByteArray> &components,
+                       const ICalTimeZoneCache &timeZoneCache,
+                       const std::vector<std::unique_ptr<ICalFormatImpl>> &workers,
+                       QThreadPool &pool);
+
     ICalFormatImpl mImpl;
     QTimeZone mTimeZone;
+    bool mStreamingLoad = false;
+    int mLoadThreadCount = 1;
 };
+
+// Returns the upper case component name if @p line is a BEGIN: or END: line.
+static QByteArray componentBoundary(const QByteArray &line, bool &begin)
+{
+    if (line.size() > 6 && qstrnicmp(line.constData(), "BEGIN:", 6) == 0) {
+        begin = true;
+        return line.mid(6).trimmed().toUpper();
+    }
+    if (line.size() > 4 && qstrnicmp(line.constData(), "END:", 4) == 0) {
+        begin = false;
+        return line.mid(4).trimmed().toUpper();
+    }
+    return QByteArray();
+}
+
+static Incidence::Ptr readComponent(ICalFormatImpl &impl, const QByteArray &data, const ICalTimeZoneCache &timeZoneCache)
+{
+    Incidence::Ptr incidence;
+    icalcomponent *c = icalcomponent_new_from_string(data.constData());
+    if (c) {
+        incidence = impl.readIncidenceComponent(c, &timeZoneCache);
+        icalcomponent_free(c);
+    } else {
+        qCWarning(KCALCORE_LOG) << "Skipping invalid component";
+    }
+    return incidence;
+}
+
+void ICalFormatPrivate::addComponents(const Calendar::Ptr &calendar,
+                                      const QList<QByteArray> &components,
+                                      const ICalTimeZoneCache &timeZoneCache,
+                                      const std::vector<std::unique_ptr<ICalFormatImpl>> &workers,
+                                      QThreadPool &pool)
+{
+    if (workers.empty()) {
+        for (const QByteArray &component : components) {
+            mImpl.addIncidence(calendar, readComponent(mImpl, component, timeZoneCache));
+            icalmemory_free_ring();
+        }
+        return;
+    }
+
+    // Each worker converts a contiguous slice of the components, then the
+    // incidences are added in file order.
+    Incidence::List incidences(components.size());
+    Incidence::Ptr *results = incidences.data();
+    const int count = components.size();
+    const int sliceSize = (count + int(workers.size()) - 1) / int(workers.size());
+    for (int first = 0, w = 0; first < count; first += sliceSize, ++w) {
+        const int last = std::min(first + sliceSize, count);
+        ICalFormatImpl *impl = workers[w].get();
+        pool.start([impl, first, last, results, &components, &timeZoneCache]() {
+            for (int i = first; i < last; ++i) {
+                results[i] = readComponent(*impl, components[i], timeZoneCache);
+            }
+            icalmemory_free_ring();
+        });
+    }
+    pool.waitForDone();
+
+    for (const Incidence::Ptr &incidence : std::as_const(incidences)) {
+        mImpl.addIncidence(calendar, incidence);
+    }
+}
+
+bool ICalFormatPrivate::loadComponents(ICalFormat *q, const Calendar::Ptr &calendar, QFile &file)
+{
+    // First pass: collect the properties of the first VCALENDAR and all the
+    // VTIMEZONE components, which incidences may refer to before they are defined.
+    QByteArray skeleton;
+    int depth = 0;
+    int calendarCount = 0;
+    QByteArray topComponent;
+    bool hasContent = false;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        bool begin = false;
+        const QByteArray name = componentBoundary(line, begin);
+        if (!name.isEmpty() && begin) {
+            ++depth;
+            if (depth == 1 && name == "VCALENDAR") {
+                ++calendarCount;
+            } else if (depth == 2) {
+                topComponent = name;
+            }
+        }
+        const bool calendarProperty = depth == 1 && calendarCount == 1 && (name.isEmpty() || begin);
+        if (calendarProperty || (depth >= 2 && topComponent == "VTIMEZONE")) {
+            skeleton += line;
+        }
+        if (!name.isEmpty() && !begin) {
+            if (depth == 2) {
+                topComponent.clear();
+            }
+            --depth;
+        }
+        hasContent = hasContent || !line.trimmed().isEmpty();
+    }
+
+    if (!hasContent) {
+        // Note: we consider empty files to be valid
+        return true;
+    }
+    if (calendarCount == 0) {
+        qCDebug(KCALCORE_LOG) << "No VCALENDAR component found";
+        q->setException(new Exception(Exception::NoCalendar));
+        return false;
+    }
+    skeleton += "END:VCALENDAR\r\n";
+
+    icalcomponent *calendarComponent = icalcomponent_new_from_string(skeleton.constData());
+    if (!calendarComponent || icalcomponent_isa(calendarComponent) != ICAL_VCALENDAR_COMPONENT) {
+        qCritical() << "parse error from icalcomponent_new_from_string. string=" << QString::fromLatin1(skeleton);
+        if (calendarComponent) {
+            icalcomponent_free(calendarComponent);
+        }
+        q->setException(new Exception(Exception::ParseErrorIcal));
+        return false;
+    }
+    skeleton.clear();
+
+    if (!mImpl.readCalendarProperties(calendar, calendarComponent)) {
+        qCDebug(KCALCORE_LOG) << "Could not populate calendar";
+        if (!q->exception()) {
+            q->setException(new Exception(Exception::ParseErrorKcal));
+        }
+        icalcomponent_free(calendarComponent);
+        return false;
+    }
+    mLoadedProductId = mImpl.loadedProductId();
+
+    ICalTimeZoneCache timeZoneCache;
+    ICalTimeZoneParser parser(&timeZoneCache);
+    parser.parse(calendarComponent);
+    icalcomponent_free(calendarComponent);
+    icalmemory_free_ring();
+
+    // Second pass: parse and add the incidences, a batch at a time.
+    const int threadCount = mLoadThreadCount > 0 ? mLoadThreadCount : QThread::idealThreadCount();
+    std::vector<std::unique_ptr<ICalFormatImpl>> workers;
+    QThreadPool pool;
+    if (threadCount > 1) {
+        pool.setMaxThreadCount(threadCount);
+        for (int i = 0; i < threadCount; ++i) {
+            workers.push_back(std::make_unique<ICalFormatImpl>(q));
+            workers.back()->copyCompat(mImpl);
+        }
+    }
+    const int batchSize = threadCount > 1 ? threadCount * 64 : 1;
+
+    const bool batchAdding = !calendar->batchAdding();
+    if (batchAdding) {
+        calendar->startBatchAdding();
+    }
+
+    file.seek(0);
+    depth = 0;
+    QList<QByteArray> components;
+    QByteArray component;
+    bool inIncidence = false;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        bool begin = false;
+        const QByteArray name = componentBoundary(line, begin);
+        if (!name.isEmpty() && begin) {
+            ++depth;
+            if (depth == 2 && (name == "VEVENT" || name == "VTODO" || name == "VJOURNAL")) {
+                inIncidence = true;
+            }
+        }
+        if (inIncidence) {
+            component += line;
+        }
+        if (!name.isEmpty() && !begin) {
+            if (depth == 2 && inIncidence) {
+                inIncidence = false;
+                components.append(component);
+                component.clear();
+                if (components.size() >= batchSize) {
+                    addComponents(calendar, components, timeZoneCache, workers, pool);
+                    components.clear();
+                }
+            }
+            --depth;
+        }
+    }
+    addComponents(calendar, components, timeZoneCache, workers, pool);
+
+    if (batchAdding) {
+        calendar->endBatchAdding();
+    }
+
+    return true;
+}
 //@endcond
 
 ICalFormat::ICalFormat()
@@ -73,6 +283,17 @@ bool ICalFormat::load(const Calendar::Ptr &calendar, const QString &fileName)
         setException(new Exception(Exception::LoadError));
         return false;
     }
+
+    Q_D(ICalFormat);
+    if (d->mStreamingLoad || d->mLoadThreadCount != 1) {
+        if (!d->loadComponents(this, calendar, file)) {
+            qCWarning(KCALCORE_LOG) << fileName << " is not a valid iCalendar file";
+            setException(new Exception(Exception::ParseErrorIcal));
+            return false;
+        }
+        return true;
+    }
+
     const QByteArray text = file.readAll().trimmed();
     file.close();
 
@@ -89,6 +310,30 @@ bool ICalFormat::load(const Calendar::Ptr &calendar, const QString &fileName)
     return true;
 }
 
+void ICalFormat::setStreamingLoad(bool enabled)
+{
+    Q_D(ICalFormat);
+    d->mStreamingLoad = enabled;
+}
+
+bool ICalFormat::streamingLoad() const
+{
+    Q_D(const ICalFormat);
+    return d->mStreamingLoad;
+}
+
+void ICalFormat::setLoadThreadCount(int count)
+{
+    Q_D(ICalFormat);
+    d->mLoadThreadCount = std::max(count, 0);
+}
+
+int ICalFormat::loadThreadCount() const
+{
+    Q_D(const ICalFormat);
+    return d->mLoadThreadCount;
+}
+
 bool ICalFormat::save(const Calendar::Ptr &calendar, const QString &fileName)
 {
     qCDebug(KCALCORE_LOG) << fileName;
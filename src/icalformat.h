@@ -60,6 +60,50 @@ public:
     */
     bool load(const Calendar::Ptr &calendar, const QString &fileName) override;
 
+    /**
+      Sets whether load() reads the file one component at a time.
+
+      By default the whole file is read and parsed at once. In streaming mode
+      the time zones and calendar properties are read first, then each VEVENT,
+      VTODO and VJOURNAL component is parsed and added to the calendar in turn,
+      so that peak memory use is bounded by the largest component rather than
+      by the size of the file.
+
+      @param enabled whether to load files in streaming mode.
+      @see streamingLoad()
+      @since 6.0
+    */
+    void setStreamingLoad(bool enabled);
+
+    /**
+      Returns whether load() reads the file one component at a time.
+      @see setStreamingLoad()
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT bool streamingLoad() const;
+
+    /**
+      Sets the number of threads load() uses to convert the components of a
+      file into incidences.
+
+      With more than one thread, the file is read in batches of components
+      which are converted in parallel and then added to the calendar in file
+      order, as in streaming mode.
+
+      @param count the number of threads, 0 to use QThread::idealThreadCount().
+      The default is 1, converting all components in the calling thread.
+      @see loadThreadCount(), setStreamingLoad()
+      @since 6.0
+    */
+    void setLoadThreadCount(int count);
+
+    /**
+      Returns the number of threads load() uses to convert components.
+      @see setLoadThreadCount()
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT int loadThreadCount() const;
+
     /**
       @copydoc
       CalFormat::save()
@@ -2655,6 +2655,28 @@ bool ICalFormatImpl::populate(const Calendar::Ptr &cal, icalcomponent *calendar)
         return false;
     }
 
+    if (!readCalendarProperties(cal, calendar)) {
+        return false;
+    }
+
+    // Populate the calendar's time zone collection with all VTIMEZONE components
+    ICalTimeZoneCache timeZoneCache;
+    ICalTimeZoneParser parser(&timeZoneCache);
+    parser.parse(calendar);
+
+    for (icalcomponent_kind kind : {ICAL_VTODO_COMPONENT, ICAL_VEVENT_COMPONENT, ICAL_VJOURNAL_COMPONENT}) {
+        for (icalcomponent *c = icalcomponent_get_first_component(calendar, kind); c; c = icalcomponent_get_next_component(calendar, kind)) {
+            populateIncidence(cal, c, &timeZoneCache);
+        }
+    }
+
+    // TODO: Remove any previous time zones no longer referenced in the calendar
+
+    return true;
+}
+
+bool ICalFormatImpl::readCalendarProperties(const Calendar::Ptr &cal, icalcomponent *calendar)
+{
     // TODO: check for METHOD
 
     icalproperty *p = icalcomponent_get_first_property(calendar, ICAL_X_PROPERTY);
@@ -2687,6 +2709,7 @@ bool ICalFormatImpl::populate(const Calendar::Ptr &cal, icalcomponent *calendar)
 
         mCompat.reset(CompatFactory::createCompat(mLoadedProductId, implementationVersion));
     }
+    mImplementationVersion = implementationVersion;
 
     p = icalcomponent_get_first_property(calendar, ICAL_VERSION_PROPERTY);
     if (!p) {
@@ -2712,11 +2735,6 @@ bool ICalFormatImpl::populate(const Calendar::Ptr &cal, icalcomponent *calendar)
         }
     }
 
-    // Populate the calendar's time zone collection with all VTIMEZONE components
-    ICalTimeZoneCache timeZoneCache;
-    ICalTimeZoneParser parser(&timeZoneCache);
-    parser.parse(calendar);
-
     // custom properties
     readCustomProperties(calendar, cal.data());
 
@@ -2725,83 +2743,105 @@ bool ICalFormatImpl::populate(const Calendar::Ptr &cal, icalcomponent *calendar)
     mTodosRelate.clear();
     // TODO: make sure that only actually added events go to this lists.
 
-    icalcomponent *c = icalcomponent_get_first_component(calendar, ICAL_VTODO_COMPONENT);
-    while (c) {
-        Todo::Ptr todo = readTodo(c, &timeZoneCache);
-        if (todo) {
-            // qCDebug(KCALCORE_LOG) << "todo is not zero";;
-            Todo::Ptr old = cal->todo(todo->uid(), todo->recurrenceId());
-            if (old) {
-                if (old->uid().isEmpty()) {
-                    qCWarning(KCALCORE_LOG) << "Skipping invalid VTODO";
-                    c = icalcomponent_get_next_component(calendar, ICAL_VTODO_COMPONENT);
-                    continue;
-                }
-                // qCDebug(KCALCORE_LOG) << "Found an old todo with uid " << old->uid();
-                if (todo->revision() > old->revision()) {
-                    // qCDebug(KCALCORE_LOG) << "Replacing old todo " << old.data() << " with this one " << todo.data();
-                    cal->deleteTodo(old); // move old to deleted
-                    removeAllICal(mTodosRelate, old);
-                    cal->addTodo(todo); // and replace it with this one
-                }
-            } else {
-                // qCDebug(KCALCORE_LOG) << "Adding todo " << todo.data() << todo->uid();
-                cal->addTodo(todo); // just add this one
+    return true;
+}
+
+void ICalFormatImpl::populateIncidence(const Calendar::Ptr &cal, icalcomponent *c, const ICalTimeZoneCache *tzList)
+{
+    addIncidence(cal, readIncidenceComponent(c, tzList));
+}
+
+Incidence::Ptr ICalFormatImpl::readIncidenceComponent(icalcomponent *c, const ICalTimeZoneCache *tzList)
+{
+    switch (icalcomponent_isa(c)) {
+    case ICAL_VTODO_COMPONENT:
+        return readTodo(c, tzList);
+    case ICAL_VEVENT_COMPONENT:
+        return readEvent(c, tzList);
+    case ICAL_VJOURNAL_COMPONENT:
+        return readJournal(c, tzList);
+    default:
+        return Incidence::Ptr();
+    }
+}
+
+void ICalFormatImpl::addIncidence(const Calendar::Ptr &cal, const Incidence::Ptr &incidence)
+{
+    if (!incidence) {
+        return;
+    }
+
+    switch (incidence->type()) {
+    case IncidenceBase::TypeTodo: {
+        Todo::Ptr todo = incidence.staticCast<Todo>();
+        // qCDebug(KCALCORE_LOG) << "todo is not zero";;
+        Todo::Ptr old = cal->todo(todo->uid(), todo->recurrenceId());
+        if (old) {
+            if (old->uid().isEmpty()) {
+                qCWarning(KCALCORE_LOG) << "Skipping invalid VTODO";
+                return;
+            }
+            // qCDebug(KCALCORE_LOG) << "Found an old todo with uid " << old->uid();
+            if (todo->revision() > old->revision()) {
+                // qCDebug(KCALCORE_LOG) << "Replacing old todo " << old.data() << " with this one " << todo.data();
+                cal->deleteTodo(old); // move old to deleted
+                removeAllICal(mTodosRelate, old);
+                cal->addTodo(todo); // and replace it with this one
             }
+        } else {
+            // qCDebug(KCALCORE_LOG) << "Adding todo " << todo.data() << todo->uid();
+            cal->addTodo(todo); // just add this one
         }
-        c = icalcomponent_get_next_component(calendar, ICAL_VTODO_COMPONENT);
-    }
-
-    // Iterate through all events
-    c = icalcomponent_get_first_component(calendar, ICAL_VEVENT_COMPONENT);
-    while (c) {
-        Event::Ptr event = readEvent(c, &timeZoneCache);
-        if (event) {
-            // qCDebug(KCALCORE_LOG) << "event is not zero";
-            Event::Ptr old = cal->event(event->uid(), event->recurrenceId());
-            if (old) {
-                if (old->uid().isEmpty()) {
-                    qCWarning(KCALCORE_LOG) << "Skipping invalid VEVENT";
-                    c = icalcomponent_get_next_component(calendar, ICAL_VEVENT_COMPONENT);
-                    continue;
-                }
-                // qCDebug(KCALCORE_LOG) << "Found an old event with uid " << old->uid();
-                if (event->revision() > old->revision()) {
-                    // qCDebug(KCALCORE_LOG) << "Replacing old event " << old.data()
-                    //                       << " with this one " << event.data();
-                    cal->deleteEvent(old); // move old to deleted
-                    removeAllICal(mEventsRelate, old);
-                    cal->addEvent(event); // and replace it with this one
-                }
-            } else {
-                // qCDebug(KCALCORE_LOG) << "Adding event " << event.data() << event->uid();
-                cal->addEvent(event); // just add this one
+        break;
+    }
+    case IncidenceBase::TypeEvent: {
+        Event::Ptr event = incidence.staticCast<Event>();
+        // qCDebug(KCALCORE_LOG) << "event is not zero";
+        Event::Ptr old = cal->event(event->uid(), event->recurrenceId());
+        if (old) {
+            if (old->uid().isEmpty()) {
+                qCWarning(KCALCORE_LOG) << "Skipping invalid VEVENT";
+                return;
             }
+            // qCDebug(KCALCORE_LOG) << "Found an old event with uid " << old->uid();
+            if (event->revision() > old->revision()) {
+                // qCDebug(KCALCORE_LOG) << "Replacing old event " << old.data()
+                //                       << " with this one " << event.data();
+                cal->deleteEvent(old); // move old to deleted
+                removeAllICal(mEventsRelate, old);
+                cal->addEvent(event); // and replace it with this one
+            }
+        } else {
+            // qCDebug(KCALCORE_LOG) << "Adding event " << event.data() << event->uid();
+            cal->addEvent(event); // just add this one
         }
-        c = icalcomponent_get_next_component(calendar, ICAL_VEVENT_COMPONENT);
+        break;
     }
-
-    // Iterate through all journals
-    c = icalcomponent_get_first_component(calendar, ICAL_VJOURNAL_COMPONENT);
-    while (c) {
-        Journal::Ptr journal = readJournal(c, &timeZoneCache);
-        if (journal) {
-            Journal::Ptr old = cal->journal(journal->uid(), journal->recurrenceId());
-            if (old) {
-                if (journal->revision() > old->revision()) {
-                    cal->deleteJournal(old); // move old to deleted
-                    cal->addJournal(journal); // and replace it with this one
-                }
-            } else {
-                cal->addJournal(journal); // just add this one
+    case IncidenceBase::TypeJournal: {
+        Journal::Ptr journal = incidence.staticCast<Journal>();
+        Journal::Ptr old = cal->journal(journal->uid(), journal->recurrenceId());
+        if (old) {
+            if (journal->revision() > old->revision()) {
+                cal->deleteJournal(old); // move old to deleted
+                cal->addJournal(journal); // and replace it with this one
             }
+        } else {
+            cal->addJournal(journal); // just add this one
         }
-        c = icalcomponent_get_next_component(calendar, ICAL_VJOURNAL_COMPONENT);
+        break;
     }
+    default:
+        break;
+    }
+}
 
-    // TODO: Remove any previous time zones no longer referenced in the calendar
-
-    return true;
+void ICalFormatImpl::copyCompat(const ICalFormatImpl &other)
+{
+    mLoadedProductId = other.mLoadedProductId;
+    mImplementationVersion = other.mImplementationVersion;
+    if (!mLoadedProductId.isEmpty()) {
+        mCompat.reset(CompatFactory::createCompat(mLoadedProductId, mImplementationVersion));
+    }
 }
 
 QString ICalFormatImpl::extractErrorProperty(icalcomponent *c)
@@ -98,6 +98,38 @@ public:
     */
     bool populate(const Calendar::Ptr &calendar, icalcomponent *fs);
 
+    /**
+      Reads the calendar level properties of the VCALENDAR @p fs into
+      @p calendar, checking its version. This is the first step of populate().
+    */
+    bool readCalendarProperties(const Calendar::Ptr &calendar, icalcomponent *fs);
+
+    /**
+      Reads a single VTODO, VEVENT or VJOURNAL component and adds it to
+      @p calendar, following the same rules as populate() for incidences
+      already existing in @p calendar.
+    */
+    void populateIncidence(const Calendar::Ptr &calendar, icalcomponent *c, const ICalTimeZoneCache *tzList);
+
+    /**
+      Reads a single VTODO, VEVENT or VJOURNAL component.
+      @return the incidence, or null if @p c is not a valid incidence component.
+    */
+    Incidence::Ptr readIncidenceComponent(icalcomponent *c, const ICalTimeZoneCache *tzList);
+
+    /**
+      Adds @p incidence, as returned by readIncidenceComponent(), to @p calendar
+      following the same rules as populate(). Null incidences are ignored.
+    */
+    void addIncidence(const Calendar::Ptr &calendar, const Incidence::Ptr &incidence);
+
+    /**
+      Applies the same compatibility fixes as @p other when reading incidences,
+      @p other having already read the calendar properties. This allows several
+      instances to read the components of one calendar in parallel.
+    */
+    void copyCompat(const ICalFormatImpl &other);
+
     Incidence::Ptr readOneIncidence(icalcomponent *calendar, const ICalTimeZoneCache *tzlist);
 
     icalcomponent *writeIncidence(const IncidenceBase::Ptr &incidence, iTIPMethod method = iTIPRequest, TimeZoneList *tzUsedList = nullptr);
@@ -232,6 +264,7 @@ private:
 
     ICalFormat *mParent = nullptr;
     QString mLoadedProductId; // PRODID string loaded from calendar file
+    QString mImplementationVersion; // KCalendarCore version which wrote the calendar file
     Event::List mEventsRelate; // events with relations
     Todo::List mTodosRelate; // todos with relations
     std::unique_ptr<Compat> mCompat;
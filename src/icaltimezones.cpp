@@ -17,12 +17,17 @@
 
 #include <QByteArray>
 #include <QDateTime>
+#include <QMutex>
 
 extern "C" {
 #include <libical/ical.h>
 #include <libical/icaltimezone.h>
 }
 
+#include <algorithm>
+#include <map>
+#include <tuple>
+
 using namespace KCalendarCore;
 
 // Minimum repetition counts for VTIMEZONE RRULEs
@@ -93,59 +98,94 @@ ICalTimeZoneCache::ICalTimeZoneCache()
 
 void ICalTimeZoneCache::insert(const QByteArray &id, const ICalTimeZone &tz)
 {
-    mCache.insert(id, tz);
-}
+    Zone zone;
+    if (QTimeZone::isTimeZoneIdAvailable(id)) {
+        zone.qZone = QTimeZone(id);
+        mCache.insert(id, zone);
+        return;
+    }
+    zone.qZone = tz.qZone;
 
-namespace
-{
-template<typename T>
-typename T::const_iterator greatestSmallerThan(const T &c, const typename T::value_type &v)
-{
-    auto it = std::lower_bound(c.cbegin(), c.cend(), v);
-    if (it != c.cbegin()) {
-        return --it;
+    // If the matched timezone is one of the UTC offset timezones, we need to make
+    // sure it's in the correct DTS.
+    // The lookup in ICalTimeZoneParser will only find TZ in standard time, but
+    // if the datetime in question fits in the DTS zone, we need to use another UTC
+    // offset timezone. Work out which zone applies from each transition once, so
+    // that tzForTime() only has to find the transition before the datetime.
+    if (tz.qZone.isValid() && tz.qZone.id().startsWith("UTC") // krazy:exclude=strings
+        && !tz.standard.transitions.isEmpty() && !tz.daylight.transitions.isEmpty()) {
+        const auto tzids = QTimeZone::availableTimeZoneIds(tz.daylight.utcOffset);
+        auto dtsTzId = std::find_if(tzids.cbegin(), tzids.cend(), [](const QByteArray &id) {
+            return id.startsWith("UTC"); // krazy:exclude=strings
+        });
+        if (dtsTzId != tzids.cend()) {
+            const QTimeZone dtsZone(*dtsTzId);
+            const qint64 firstStandard = tz.standard.transitions.constFirst().toMSecsSinceEpoch();
+            for (const QDateTime &transition : tz.daylight.transitions) {
+                const qint64 utc = transition.toMSecsSinceEpoch();
+                // DTS only applies once a standard transition has occurred
+                zone.transitions.append({utc, utc > firstStandard ? dtsZone : tz.qZone});
+            }
+            for (const QDateTime &transition : tz.standard.transitions) {
+                zone.transitions.append({transition.toMSecsSinceEpoch(), tz.qZone});
+            }
+            // On equal times, the standard transition wins
+            std::stable_sort(zone.transitions.begin(), zone.transitions.end(), [](const Transition &t1, const Transition &t2) {
+                return t1.utc < t2.utc;
+            });
+        }
     }
-    return c.cend();
+    mCache.insert(id, zone);
 }
 
+//@cond PRIVATE
+// Time zones for the TZIDs not defined by a VTIMEZONE, shared by all caches.
+struct AvailableTimeZones {
+    QMutex lock;
+    QHash<QByteArray, QTimeZone> zones;
+};
+Q_GLOBAL_STATIC(AvailableTimeZones, s_availableTimeZones)
+
+// Limit to the number of available time zones kept
+static const int maxAvailableTimeZones = 1024;
+
+static QTimeZone availableTimeZone(const QByteArray &tzid)
+{
+    AvailableTimeZones *available = s_availableTimeZones();
+    QMutexLocker locker(&available->lock);
+    const auto it = available->zones.constFind(tzid);
+    if (it != available->zones.cend()) {
+        return it.value();
+    }
+    const QTimeZone zone = QTimeZone::isTimeZoneIdAvailable(tzid) ? QTimeZone(tzid) : QTimeZone();
+    if (available->zones.size() >= maxAvailableTimeZones) {
+        available->zones.clear();
+    }
+    available->zones.insert(tzid, zone);
+    return zone;
 }
+//@endcond
 
 QTimeZone ICalTimeZoneCache::tzForTime(const QDateTime &dt, const QByteArray &tzid) const
 {
-    if (QTimeZone::isTimeZoneIdAvailable(tzid)) {
-        return QTimeZone(tzid);
+    const auto it = mCache.constFind(tzid);
+    if (it == mCache.cend()) {
+        return availableTimeZone(tzid);
     }
 
-    const ICalTimeZone tz = mCache.value(tzid);
-    if (!tz.qZone.isValid()) {
-        return QTimeZone();
+    const Zone &zone = it.value();
+    if (zone.transitions.isEmpty() || !dt.isValid()) {
+        return zone.qZone;
     }
-
-    // If the matched timezone is one of the UTC offset timezones, we need to make
-    // sure it's in the correct DTS.
-    // The lookup in ICalTimeZoneParser will only find TZ in standard time, but
-    // if the datetim in question fits in the DTS zone, we need to use another UTC
-    // offset timezone
-    if (tz.qZone.id().startsWith("UTC")) { // krazy:exclude=strings
-        // Find the nearest standard and DST transitions that occur BEFORE the "dt"
-        const auto stdPrev = greatestSmallerThan(tz.standard.transitions, dt);
-        const auto dstPrev = greatestSmallerThan(tz.daylight.transitions, dt);
-        if (stdPrev != tz.standard.transitions.cend() && dstPrev != tz.daylight.transitions.cend()) {
-            if (*dstPrev > *stdPrev) {
-                // Previous DTS is closer to "dt" than previous standard, which
-                // means we are in DTS right now
-                const auto tzids = QTimeZone::availableTimeZoneIds(tz.daylight.utcOffset);
-                auto dtsTzId = std::find_if(tzids.cbegin(), tzids.cend(), [](const QByteArray &id) {
-                    return id.startsWith("UTC"); // krazy:exclude=strings
-                });
-                if (dtsTzId != tzids.cend()) {
-                    return QTimeZone(*dtsTzId);
-                }
-            }
-        }
+    // Find the nearest transition that occurs BEFORE the "dt"
+    const qint64 utc = dt.toMSecsSinceEpoch();
+    auto prev = std::partition_point(zone.transitions.cbegin(), zone.transitions.cend(), [utc](const Transition &transition) {
+        return transition.utc < utc;
+    });
+    if (prev == zone.transitions.cbegin()) {
+        return zone.qZone;
     }
-
-    return tz.qZone;
+    return (--prev)->zone;
 }
 
 ICalTimeZoneParser::ICalTimeZoneParser(ICalTimeZoneCache *cache)
@@ -203,33 +243,31 @@ icalcomponent *ICalTimeZoneParser::icalcomponentFromQTimeZone(const QTimeZone &t
             }
         }
     }
-    int trcount = transits.count();
-    QList<bool> transitionsDone(trcount, false);
+    const int trcount = transits.count();
 
-    // Go through the list of transitions and create an iCal component for each
-    // distinct combination of phase after and UTC offset before the transition.
+    // Group the transitions by the distinct combination of phase after and
+    // UTC offset before the transition, in order of their first transitions.
+    QList<QList<int>> phaseTransitions;
+    std::map<std::tuple<int, int, int>, qsizetype> phaseIndexes; // (UTC offset before, UTC offset after, DST offset after)
+    for (int i = 0; i < trcount; ++i) {
+        const int preOffset = (i > 0) ? transits.at(i - 1).offsetFromUtc : 0;
+        const auto key = std::make_tuple(preOffset, transits.at(i).offsetFromUtc, transits.at(i).daylightTimeOffset);
+        const auto it = phaseIndexes.try_emplace(key, phaseTransitions.size()).first;
+        if (it->second == phaseTransitions.size()) {
+            phaseTransitions.append(QList<int>());
+        }
+        phaseTransitions[it->second].append(i);
+    }
+
+    // Go through the groups of transitions and create an iCal component for each.
     icaldatetimeperiodtype dtperiod;
     dtperiod.period = icalperiodtype_null_period();
-    for (;;) {
-        int i = 0;
-        for (; i < trcount && transitionsDone[i]; ++i) {
-            ;
-        }
-        if (i >= trcount) {
-            break;
-        }
-        // Found a phase combination which hasn't yet been processed
+    for (const QList<int> &phase : std::as_const(phaseTransitions)) {
+        int p = 0;
+        int i = phase.at(p);
         const int preOffset = (i > 0) ? transits.at(i - 1).offsetFromUtc : 0;
         const auto &transit = transits.at(i);
         if (transit.offsetFromUtc == preOffset) {
-            transitionsDone[i] = true;
-            while (++i < trcount) {
-                if (transitionsDone[i] || transits.at(i).offsetFromUtc != transit.offsetFromUtc
-                    || transits.at(i).daylightTimeOffset != transit.daylightTimeOffset || transits.at(i - 1).offsetFromUtc != preOffset) {
-                    continue;
-                }
-                transitionsDone[i] = true;
-            }
             continue;
         }
         const bool isDst = transit.daylightTimeOffset > 0;
@@ -261,7 +299,6 @@ icalcomponent *ICalTimeZoneParser::icalcomponentFromQTimeZone(const QTimeZone &t
         QList<QDateTime> times;
         QDateTime qdt = transits.at(i).atUtc; // set 'qdt' for start of loop
         times += qdt;
-        transitionsDone[i] = true;
         do {
             if (!rule) {
                 // Initialise data for detecting a new rule
@@ -276,15 +313,11 @@ icalcomponent *ICalTimeZoneParser::icalcomponentFromQTimeZone(const QTimeZone &t
                 nthFromStart = (dayOfMonth - 1) / 7 + 1; // nth (weekday) of month
                 nthFromEnd = (daysInMonth - dayOfMonth) / 7 + 1; // nth last (weekday) of month
             }
-            if (++i >= trcount) {
+            if (++p >= phase.size()) {
                 newRule = 0;
                 times += QDateTime(); // append a dummy value since last value in list is ignored
             } else {
-                if (transitionsDone[i] || transits.at(i).offsetFromUtc != transit.offsetFromUtc
-                    || transits.at(i).daylightTimeOffset != transit.daylightTimeOffset || transits.at(i - 1).offsetFromUtc != preOffset) {
-                    continue;
-                }
-                transitionsDone[i] = true;
+                i = phase.at(p);
                 qdt = transits.at(i).atUtc;
                 if (!qdt.isValid()) {
                     continue;
@@ -377,7 +410,7 @@ icalcomponent *ICalTimeZoneParser::icalcomponentFromQTimeZone(const QTimeZone &t
                 times += qdt;
             }
             rule = newRule;
-        } while (i < trcount);
+        } while (p < phase.size());
 
         // Write remaining dates as RDATEs
         for (int rd = 0, rdend = rdates.count(); rd < rdend; ++rd) {
@@ -391,10 +424,65 @@ icalcomponent *ICalTimeZoneParser::icalcomponentFromQTimeZone(const QTimeZone &t
     return tzcomp;
 }
 
+//@cond PRIVATE
+// VTIMEZONE components generated from time zones, shared by all saves since
+// the same zones are written every time a calendar is saved.
+struct GeneratedTimeZones {
+    ~GeneratedTimeZones()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (icalcomponent *component : std::as_const(components)) {
+            icalcomponent_free(component);
+        }
+        components.clear();
+    }
+
+    QMutex lock;
+    QHash<QByteArray, icalcomponent *> components;
+};
+Q_GLOBAL_STATIC(GeneratedTimeZones, s_generatedTimeZones)
+
+// Limit to the number of generated components kept
+static const int maxGeneratedTimeZones = 256;
+//@endcond
+
 icaltimezone *ICalTimeZoneParser::icaltimezoneFromQTimeZone(const QTimeZone &tz, const QDateTime &earliest)
 {
+    // Write the transitions from the start of the year of 'earliest', so that
+    // saves with nearby earliest dates share the same component.
+    QByteArray key = tz.id() + ' ';
+    QDateTime from;
+    if (earliest.isValid()) {
+        const int year = earliest.toUTC().date().year();
+        from = QDateTime(QDate(year, 1, 1), QTime(0, 0), QTimeZone::utc());
+        key += QByteArray::number(year);
+    }
+
+    icalcomponent *tzcomp = nullptr;
+    GeneratedTimeZones *generated = s_generatedTimeZones();
+    {
+        QMutexLocker locker(&generated->lock);
+        if (icalcomponent *component = generated->components.value(key)) {
+            tzcomp = icalcomponent_new_clone(component);
+        }
+    }
+    if (!tzcomp) {
+        tzcomp = icalcomponentFromQTimeZone(tz, from);
+        QMutexLocker locker(&generated->lock);
+        if (!generated->components.contains(key)) {
+            if (generated->components.size() >= maxGeneratedTimeZones) {
+                generated->clear();
+            }
+            generated->components.insert(key, icalcomponent_new_clone(tzcomp));
+        }
+    }
+
     auto itz = icaltimezone_new();
-    icaltimezone_set_component(itz, icalcomponentFromQTimeZone(tz, earliest));
+    icaltimezone_set_component(itz, tzcomp);
     return itz;
 }
 
@@ -417,9 +505,36 @@ void ICalTimeZoneParser::parse(icalcomponent *calendar)
     }
 }
 
-QTimeZone ICalTimeZoneParser::resolveICalTimeZone(const ICalTimeZone &icalZone)
+//@cond PRIVATE
+// Time zones resolved from VTIMEZONE phases, shared by all parsers since the
+// same custom VTIMEZONEs tend to be repeated in every invitation of a sender.
+struct ResolvedTimeZones {
+    QMutex lock;
+    QHash<QByteArray, QTimeZone> zones;
+};
+Q_GLOBAL_STATIC(ResolvedTimeZones, s_resolvedTimeZones)
+
+// Limit to the number of resolved time zones kept
+static const int maxResolvedTimeZones = 1024;
+
+// Canonical fingerprint of the phase data which matchTimeZone() depends on
+static QByteArray phaseKey(const ICalTimeZonePhase &phase)
+{
+    QList<QByteArray> abbrevs(phase.abbrevs.cbegin(), phase.abbrevs.cend());
+    std::sort(abbrevs.begin(), abbrevs.end());
+    QByteArray key = QByteArray::number(phase.utcOffset);
+    for (const QByteArray &abbrev : std::as_const(abbrevs)) {
+        key += ' ' + QByteArray::number(abbrev.size()) + ':' + abbrev;
+    }
+    key += ';';
+    for (const QDateTime &transition : phase.transitions) {
+        key += QByteArray::number(transition.toMSecsSinceEpoch()) + ',';
+    }
+    return key;
+}
+
+static QTimeZone matchTimeZone(const ICalTimeZonePhase &phase)
 {
-    const auto phase = icalZone.standard;
     const auto now = QDateTime::currentDateTimeUtc();
 
     const auto candidates = QTimeZone::availableTimeZoneIds(phase.utcOffset);
@@ -474,6 +589,30 @@ QTimeZone ICalTimeZoneParser::resolveICalTimeZone(const ICalTimeZone &icalZone)
 
     return {};
 }
+//@endcond
+
+QTimeZone ICalTimeZoneParser::resolveICalTimeZone(const ICalTimeZone &icalZone)
+{
+    const QByteArray key = phaseKey(icalZone.standard);
+    ResolvedTimeZones *resolved = s_resolvedTimeZones();
+    {
+        QMutexLocker locker(&resolved->lock);
+        const auto it = resolved->zones.constFind(key);
+        if (it != resolved->zones.cend()) {
+            return it.value();
+        }
+    }
+
+    // Match outside the lock: it's slow, and concurrent parsers matching the
+    // same phase get the same result.
+    const QTimeZone tz = matchTimeZone(icalZone.standard);
+    QMutexLocker locker(&resolved->lock);
+    if (resolved->zones.size() >= maxResolvedTimeZones) {
+        resolved->zones.clear();
+    }
+    resolved->zones.insert(key, tz);
+    return tz;
+}
 
 ICalTimeZone ICalTimeZoneParser::parseTimeZone(icalcomponent *vtimezone)
 {
@@ -58,7 +58,15 @@ public:
     QTimeZone tzForTime(const QDateTime &dt, const QByteArray &tzid) const;
 
 private:
-    QHash<QByteArray, ICalTimeZone> mCache;
+    struct Transition {
+        qint64 utc; // transition time, milliseconds since epoch
+        QTimeZone zone; // time zone to use from the transition on
+    };
+    struct Zone {
+        QTimeZone qZone; // time zone to use without a transition
+        QList<Transition> transitions; // for UTC offset zones with DST only
+    };
+    QHash<QByteArray, Zone> mCache;
 };
 
 using TimeZoneEarliestDate = QHash<QTimeZone, QDateTime>;
@@ -0,0 +1,264 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCALCORE_INTERVALTREE_P_H
+#define KCALCORE_INTERVALTREE_P_H
+
+#include <QAtomicInt>
+#include <QtGlobal>
+
+#include <functional>
+
+namespace KCalendarCore
+{
+/**
+  An interval tree storing closed intervals [start, end] on a qint64 axis.
+
+  It is implemented as a treap ordered by (start, value), where every node
+  caches the largest end of its subtree so that overlap queries can skip
+  whole subtrees. Insertion and removal are O(log N) expected, an overlap
+  query is O(log N + k).
+
+  The tree is implicitly shared: copying it is O(1), and nodes are only
+  copied when a tree modifies a path it shares with another copy. A copy can
+  therefore be read from another thread while the original is modified,
+  provided the copy itself was made while no other thread was modifying it.
+
+  @p T is a QSharedPointer-like handle; its data() pointer is used to order
+  values sharing the same start, and to identify the value on removal.
+  @internal
+*/
+//@cond PRIVATE
+template<typename T>
+class IntervalTree
+{
+public:
+    IntervalTree() = default;
+    IntervalTree(const IntervalTree &other)
+        : mRoot(other.mRoot)
+        , mSize(other.mSize)
+        , mSeed(other.mSeed)
+    {
+        if (mRoot) {
+            mRoot->ref.ref();
+        }
+    }
+    ~IntervalTree()
+    {
+        release(mRoot);
+    }
+
+    IntervalTree &operator=(const IntervalTree &other)
+    {
+        if (other.mRoot) {
+            other.mRoot->ref.ref();
+        }
+        release(mRoot);
+        mRoot = other.mRoot;
+        mSize = other.mSize;
+        mSeed = other.mSeed;
+        return *this;
+    }
+
+    /**
+      Inserts @p value covering [@p start, @p end].
+    */
+    void insert(qint64 start, qint64 end, const T &value)
+    {
+        Node *node = new Node{1, start, end, end, nextPriority(), value, nullptr, nullptr};
+        Node *left = nullptr;
+        Node *right = nullptr;
+        split(mRoot, start, value.data(), left, right);
+        mRoot = merge(merge(left, node), right);
+        ++mSize;
+    }
+
+    /**
+      Removes @p value, which must have been inserted with @p start.
+      @return true if the value was found.
+    */
+    bool remove(qint64 start, const T &value)
+    {
+        bool removed = false;
+        mRoot = remove(mRoot, start, value.data(), removed);
+        if (removed) {
+            --mSize;
+        }
+        return removed;
+    }
+
+    void clear()
+    {
+        release(mRoot);
+        mRoot = nullptr;
+        mSize = 0;
+    }
+
+    int size() const
+    {
+        return mSize;
+    }
+
+    /**
+      Calls @p func for every value whose interval intersects [@p low, @p high],
+      in ascending order of start.
+    */
+    template<typename Func>
+    void forEachOverlapping(qint64 low, qint64 high, Func &&func) const
+    {
+        forEachOverlapping(mRoot, low, high, func);
+    }
+
+private:
+    struct Node {
+        QAtomicInt ref;
+        qint64 start;
+        qint64 end;
+        qint64 maxEnd;
+        quint32 priority;
+        T value;
+        Node *left;
+        Node *right;
+    };
+
+    quint32 nextPriority()
+    {
+        // xorshift32, good enough to keep the treap balanced.
+        mSeed ^= mSeed << 13;
+        mSeed ^= mSeed >> 17;
+        mSeed ^= mSeed << 5;
+        return mSeed;
+    }
+
+    static bool lessThan(qint64 start1, const void *value1, qint64 start2, const void *value2)
+    {
+        return start1 < start2 || (start1 == start2 && std::less<const void *>()(value1, value2));
+    }
+
+    // Returns a node which only the calling tree references, in place of @p node
+    // whose reference is transferred to the result.
+    static Node *unshare(Node *node)
+    {
+        if (node->ref.loadRelaxed() == 1) {
+            return node;
+        }
+        Node *copy = new Node{1, node->start, node->end, node->maxEnd, node->priority, node->value, node->left, node->right};
+        if (copy->left) {
+            copy->left->ref.ref();
+        }
+        if (copy->right) {
+            copy->right->ref.ref();
+        }
+        release(node);
+        return copy;
+    }
+
+    static void refresh(Node *node)
+    {
+        node->maxEnd = node->end;
+        if (node->left && node->left->maxEnd > node->maxEnd) {
+            node->maxEnd = node->left->maxEnd;
+        }
+        if (node->right && node->right->maxEnd > node->maxEnd) {
+            node->maxEnd = node->right->maxEnd;
+        }
+    }
+
+    // Splits @p node into the nodes ordered before (start, value) and the others.
+    static void split(Node *node, qint64 start, const void *value, Node *&left, Node *&right)
+    {
+        if (!node) {
+            left = right = nullptr;
+            return;
+        }
+        node = unshare(node);
+        if (lessThan(node->start, node->value.data(), start, value)) {
+            split(node->right, start, value, node->right, right);
+            left = node;
+        } else {
+            split(node->left, start, value, left, node->left);
+            right = node;
+        }
+        refresh(node);
+    }
+
+    // Merges two treaps, all nodes of @p left being ordered before those of @p right.
+    static Node *merge(Node *left, Node *right)
+    {
+        if (!left) {
+            return right;
+        }
+        if (!right) {
+            return left;
+        }
+        if (left->priority > right->priority) {
+            left = unshare(left);
+            left->right = merge(left->right, right);
+            refresh(left);
+            return left;
+        }
+        right = unshare(right);
+        right->left = merge(left, right->left);
+        refresh(right);
+        return right;
+    }
+
+    static Node *remove(Node *node, qint64 start, const void *value, bool &removed)
+    {
+        if (!node) {
+            return nullptr;
+        }
+        node = unshare(node);
+        if (node->start == start && node->value.data() == value) {
+            Node *replacement = merge(node->left, node->right);
+            delete node;
+            removed = true;
+            return replacement;
+        }
+        if (lessThan(start, value, node->start, node->value.data())) {
+            node->left = remove(node->left, start, value, removed);
+        } else {
+            node->right = remove(node->right, start, value, removed);
+        }
+        refresh(node);
+        return node;
+    }
+
+    template<typename Func>
+    static void forEachOverlapping(const Node *node, qint64 low, qint64 high, Func &func)
+    {
+        while (node && node->maxEnd >= low) {
+            forEachOverlapping(node->left, low, high, func);
+            if (node->start > high) {
+                return;
+            }
+            if (node->end >= low) {
+                func(node->value);
+            }
+            node = node->right;
+        }
+    }
+
+    static void release(Node *node)
+    {
+        if (node && !node->ref.deref()) {
+            release(node->left);
+            release(node->right);
+            delete node;
+        }
+    }
+
+    Node *mRoot = nullptr;
+    int mSize = 0;
+    quint32 mSeed = 2463534242u;
+};
+//@endcond
+
+}
+
+#endif
@@ -20,40 +20,46 @@
  */
 
 #include "memorycalendar.h"
+#include "calendar_p.h"
+#include "calfilter.h"
 #include "calformat.h"
+#include "intervaltree_p.h"
 #include "kcalendarcore_debug.h"
 
 #include <QDate>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
 
+#include <algorithm>
+#include <cstdlib>
 #include <functional>
+#include <limits>
+#include <map>
 
 using namespace KCalendarCore;
 
+namespace KCalendarCore
+{
+//@cond PRIVATE
 /**
-  Private class that helps to provide binary compatibility between releases.
+  The incidence indexes of a MemoryCalendar, and the queries answered from them.
+
+  All the indexes are implicitly shared, so that MemoryCalendar::Snapshot can
+  take a copy in constant time. The calendar then only copies the parts of an
+  index it modifies, leaving the copy unaffected.
   @internal
 */
-//@cond PRIVATE
-class Q_DECL_HIDDEN KCalendarCore::MemoryCalendar::Private
+class Q_DECL_HIDDEN MemoryCalendarIndex
 {
-private:
+protected:
     static constexpr int incidenceTypeCount = 4;
 
 public:
-    Private(MemoryCalendar *qq)
-        : q(qq)
-        , mFormat(nullptr)
-        , mUpdateLastModified(true)
-    {
-    }
-    ~Private()
-    {
-    }
-
-    MemoryCalendar *q;
-    CalFormat *mFormat; // calendar format
-    QString mIncidenceBeingUpdated; //  Instance identifier of Incidence currently being updated
-    bool mUpdateLastModified; // Call setLastModified() on incidence modific ations
+    /**
+     * Time zone of the calendar, which mIncidencesForDate is keyed in.
+     */
+    QTimeZone mTimeZone;
 
     /**
      * List of all incidences.
@@ -79,13 +85,34 @@ public:
      */
     QMultiHash<QDate, Incidence::Ptr> mIncidencesForDate[incidenceTypeCount];
 
-    void insertIncidence(const Incidence::Ptr &incidence);
+    /**
+     * Events indexed by the time span they may cover, in UTC milliseconds since
+     * epoch, so that they can be queried in any time zone.
+     *
+     * mEventSpans holds non-recurring single day events and mMultiDayEventSpans
+     * non-recurring multi-day events, keyed on [dtStart, dtEnd].
+     * mRecurringEventSpans holds recurring events keyed on [dtStart, end of
+     * the last occurrence], with a margin so the bound holds in any time zone,
+     * as well as events without a valid start which cannot be bounded at all.
+     * rawEvents() and rawEventsForDate() only check the candidates returned by
+     * these trees.
+     */
+    IntervalTree<Incidence::Ptr> mEventSpans;
+    IntervalTree<Incidence::Ptr> mMultiDayEventSpans;
+    IntervalTree<Incidence::Ptr> mRecurringEventSpans;
+
+    static bool eventInRange(const Event::Ptr &event, const QDateTime &st, const QDateTime &nd, const QTimeZone &ts, bool inclusive);
 
     Incidence::Ptr incidence(const QString &uid, IncidenceBase::IncidenceType type, const QDateTime &recurrenceId = {}) const;
 
-    bool deleteIncidence(const QString &uid, IncidenceBase::IncidenceType type, const QDateTime &recurrenceId = {});
+    Event::List rawEvents(const QDate &start, const QDate &end, const QTimeZone &timeZone, bool inclusive) const;
 
-    void deleteAllIncidences(IncidenceBase::IncidenceType type);
+    /**
+     * Events occurring on @p date. Recurring events are only checked if
+     * @p recurring is true, so that MemoryCalendar can look them up in its
+     * occurrence index instead.
+     */
+    Event::List rawEventsForDate(const QDate &date, const QTimeZone &timeZone, bool recurring = true) const;
 
     template<typename IncidenceType, typename Key>
     void forIncidences(const QMultiHash<Key, Incidence::Ptr> &incidences, const Key &key, std::function<void(const typename IncidenceType::Ptr &)> &&op) const
@@ -140,17 +167,204 @@ public:
     }
 };
 //@endcond
+}
+
+/**
+  Private class that helps to provide binary compatibility between releases.
+  @internal
+*/
+//@cond PRIVATE
+class Q_DECL_HIDDEN KCalendarCore::MemoryCalendar::Private : public MemoryCalendarIndex
+{
+public:
+    Private(MemoryCalendar *qq)
+        : q(qq)
+        , mFormat(nullptr)
+        , mUpdateLastModified(true)
+    {
+    }
+    ~Private()
+    {
+    }
+
+    MemoryCalendar *q;
+    CalFormat *mFormat; // calendar format
+    QString mIncidenceBeingUpdated; //  Instance identifier of Incidence currently being updated
+    bool mUpdateLastModified; // Call setLastModified() on incidence modific ations
+
+    /**
+     * Held while the indexes are modified, and while snapshot() copies them.
+     * mSnapshot is the last snapshot taken, reset by every modification so that
+     * it is only shared with the readers still using it.
+     */
+    mutable QMutex mSnapshotLock;
+    mutable Snapshot mSnapshot;
+
+    /**
+     * All the incidences, ordered as Incidences::dateLessThan() orders them.
+     * Built by rawIncidences() when first needed and dropped together with
+     * mSnapshot, so that only the first call after a modification sorts.
+     */
+    mutable Incidence::List mOrderedIncidences;
+    mutable bool mOrderedIncidencesValid = false;
+
+    // Called with mSnapshotLock held by every modification.
+    void dropReaderCaches()
+    {
+        mSnapshot = Snapshot();
+        mOrderedIncidences.clear();
+        mOrderedIncidencesValid = false;
+    }
+
+    struct EventSpanKey {
+        qint64 start;
+        IntervalTree<Incidence::Ptr> MemoryCalendarIndex::*tree;
+    };
+
+    /**
+     * Key and tree each event was indexed in, so that it can be removed from
+     * the span trees even after its dates or recurrence have changed.
+     */
+    QHash<const Incidence *, EventSpanKey> mEventSpanKeys;
+
+    /**
+     * Alarm schedule: for each event and incomplete to-do having alarms, the
+     * next time after mAlarmsCheckedUntil at which one of them triggers, in UTC
+     * milliseconds since epoch. Only built once nextAlarmTime() or alarmsUntil()
+     * is used.
+     */
+    bool mAlarmScheduleBuilt = false;
+    QDateTime mAlarmsCheckedUntil;
+    std::multimap<qint64, Incidence::Ptr> mAlarmSchedule;
+    QHash<const Incidence *, std::multimap<qint64, Incidence::Ptr>::iterator> mAlarmScheduleEntries;
+
+    /**
+     * Occurrence index: the recurring events occurring on each day, in the
+     * calendar's time zone, as rawEventsForDate() would find them with
+     * recursOn(). Only the months in mExpandedMonths are indexed; they are
+     * expanded the first time rawEventsForDate() is asked for one of their
+     * days, within occurrenceWindowMonths of the current month.
+     * mOccurrenceDays holds the days each event was indexed on, so that it
+     * can be removed even after its recurrence has changed.
+     */
+    static constexpr int occurrenceWindowMonths = 18;
+    QSet<int> mExpandedMonths;
+    QMultiHash<QDate, Incidence::Ptr> mOccurrencesForDate;
+    QHash<const Incidence *, QList<QDate>> mOccurrenceDays;
+
+    /**
+     * Lookup indexes: incidences by schedulingID(), by the uids of their
+     * relatedTo() relations, by the uid of their parent and by category.
+     * To-dos are also indexed by attendee email (an empty email for those
+     * without attendees) and by completion, completed ones by the UTC
+     * milliseconds of their completion date, for CalFilter criteria.
+     * mLookupKeys holds the keys each incidence was indexed with, so that it
+     * can be removed after they have changed.
+     */
+    struct LookupKeys {
+        QString schedulingId;
+        QString parent;
+        QStringList relatedTo;
+        QStringList categories;
+        QStringList attendees;
+        bool completed = false;
+        qint64 completedAt = 0;
+    };
+    QMultiHash<QString, Incidence::Ptr> mIncidencesBySchedulingId;
+    QMultiHash<QString, Incidence::Ptr> mIncidencesByRelatedTo;
+    QMultiHash<QString, Incidence::Ptr> mChildIncidences;
+    QMultiHash<QString, Incidence::Ptr> mIncidencesByCategory;
+    QStringList mCategories; // keys of mIncidencesByCategory, in the order they came into use
+    QMultiHash<QString, Incidence::Ptr> mTodosByAttendee;
+    QHash<const Incidence *, Incidence::Ptr> mOpenTodos;
+    QMultiMap<qint64, Incidence::Ptr> mCompletedTodos;
+    QHash<const Incidence *, LookupKeys> mLookupKeys;
+
+    void insertIncidence(const Incidence::Ptr &incidence);
+
+    void buildAlarmSchedule();
+
+    void scheduleAlarms(const Incidence::Ptr &incidence);
+
+    void unscheduleAlarms(const Incidence::Ptr &incidence);
+
+    void indexEventSpan(const Incidence::Ptr &incidence);
+
+    void unindexEventSpan(const Incidence::Ptr &incidence);
+
+    void indexLookupKeys(const Incidence::Ptr &incidence);
+
+    void unindexLookupKeys(const Incidence::Ptr &incidence);
+
+    Incidence::Ptr mainIncidence(const QString &uid) const;
+
+    bool filterCandidates(const CalFilter *filter, Incidence::IncidenceType type, Incidence::List &candidates) const;
+
+    // Returns the incidences of a type which pass the calendar filter, only
+    // checking those which filterCandidates() finds in the indexes if it can.
+    template<typename IncidenceType>
+    typename IncidenceType::List filteredIncidences(Incidence::IncidenceType type) const
+    {
+        const CalFilter *filter = q->filter();
+        Incidence::List candidates;
+        if (!filterCandidates(filter, type, candidates)) {
+            candidates = mIncidences[type].values();
+        }
+        typename IncidenceType::List list;
+        for (const Incidence::Ptr &incidence : std::as_const(candidates)) {
+            if (filter->filterIncidence(incidence)) {
+                list.append(incidence.staticCast<IncidenceType>());
+            }
+        }
+        return list;
+    }
+
+    static int monthIndex(const QDate &date)
+    {
+        return date.year() * 12 + date.month() - 1;
+    }
+
+    bool inOccurrenceWindow(const QDate &date) const;
+
+    void expandOccurrences(const QDate &date);
+
+    void pruneOccurrences();
+
+    void indexOccurrences(const Incidence::Ptr &incidence, int month);
+
+    void indexOccurrences(const Incidence::Ptr &incidence);
+
+    void unindexOccurrences(const Incidence::Ptr &incidence);
+
+    void clearOccurrences();
+
+    bool deleteIncidence(const QString &uid, IncidenceBase::IncidenceType type, const QDateTime &recurrenceId = {});
+
+    void deleteAllIncidences(IncidenceBase::IncidenceType type);
+};
+
+class Q_DECL_HIDDEN KCalendarCore::MemoryCalendar::Snapshot::Private : public MemoryCalendarIndex
+{
+public:
+    explicit Private(const MemoryCalendarIndex &index)
+        : MemoryCalendarIndex(index)
+    {
+    }
+};
+//@endcond
 
 MemoryCalendar::MemoryCalendar(const QTimeZone &timeZone)
     : Calendar(timeZone)
     , d(new KCalendarCore::MemoryCalendar::Private(this))
 {
+    d->mTimeZone = this->timeZone();
 }
 
 MemoryCalendar::MemoryCalendar(const QByteArray &timeZoneId)
     : Calendar(timeZoneId)
     , d(new KCalendarCore::MemoryCalendar::Private(this))
 {
+    d->mTimeZone = timeZone();
 }
 
 MemoryCalendar::~MemoryCalendar()
@@ -174,10 +388,15 @@ MemoryCalendar::~MemoryCalendar()
 
 void MemoryCalendar::doSetTimeZone(const QTimeZone &timeZone)
 {
+    QMutexLocker locker(&d->mSnapshotLock);
+    d->dropReaderCaches();
+    d->mTimeZone = timeZone;
+
     // Reset date based hashes before storing for the new zone.
     for (auto &table : d->mIncidencesForDate) {
         table.clear();
     }
+    d->clearOccurrences();
 
     for (auto &table : d->mIncidences) {
         for (const auto &incidence : table) {
@@ -246,12 +465,20 @@ bool MemoryCalendar::Private::deleteIncidence(const QString &uid, IncidenceBase:
         } else if (!recurrenceId.isNull() && (!incidence->hasRecurrenceId() || recurrenceId != incidence->recurrenceId())) {
             continue;
         }
+        QMutexLocker locker(&mSnapshotLock);
+        dropReaderCaches();
         mIncidences[type].erase(it);
         mIncidencesByIdentifier.remove(incidence->instanceIdentifier());
         const QDateTime dt = incidence->dateTime(Incidence::RoleCalendarHashing);
         if (dt.isValid()) {
             mIncidencesForDate[type].remove(dt.toTimeZone(q->timeZone()).date(), incidence);
         }
+        if (type == Incidence::TypeEvent) {
+            unindexEventSpan(incidence);
+            unindexOccurrences(incidence);
+        }
+        unindexLookupKeys(incidence);
+        unscheduleAlarms(incidence);
         return true;
     }
     return false;
@@ -262,12 +489,23 @@ void MemoryCalendar::Private::deleteAllIncidences(Incidence::IncidenceType incid
     for (auto &incidence : mIncidences[incidenceType]) {
         q->notifyIncidenceAboutToBeDeleted(incidence);
         incidence->unRegisterObserver(q);
+        unindexLookupKeys(incidence);
+        unscheduleAlarms(incidence);
     }
+    QMutexLocker locker(&mSnapshotLock);
+    dropReaderCaches();
     mIncidences[incidenceType].clear();
     mIncidencesForDate[incidenceType].clear();
+    if (incidenceType == Incidence::TypeEvent) {
+        mEventSpans.clear();
+        mMultiDayEventSpans.clear();
+        mRecurringEventSpans.clear();
+        mEventSpanKeys.clear();
+        clearOccurrences();
+    }
 }
 
-Incidence::Ptr MemoryCalendar::Private::incidence(const QString &uid, Incidence::IncidenceType type, const QDateTime &recurrenceId) const
+Incidence::Ptr MemoryCalendarIndex::incidence(const QString &uid, Incidence::IncidenceType type, const QDateTime &recurrenceId) const
 {
     return findIncidence(mIncidences[type], uid, recurrenceId);
 }
@@ -277,12 +515,20 @@ void MemoryCalendar::Private::insertIncidence(const Incidence::Ptr &incidence)
     const QString uid = incidence->uid();
     const Incidence::IncidenceType type = incidence->type();
     if (!mIncidences[type].contains(uid, incidence)) {
+        QMutexLocker locker(&mSnapshotLock);
+        dropReaderCaches();
         mIncidences[type].insert(uid, incidence);
         mIncidencesByIdentifier.insert(incidence->instanceIdentifier(), incidence);
         const QDateTime dt = incidence->dateTime(Incidence::RoleCalendarHashing);
         if (dt.isValid()) {
             mIncidencesForDate[type].insert(dt.toTimeZone(q->timeZone()).date(), incidence);
         }
+        if (type == Incidence::TypeEvent) {
+            indexEventSpan(incidence);
+            indexOccurrences(incidence);
+        }
+        indexLookupKeys(incidence);
+        scheduleAlarms(incidence);
 
     } else {
 #ifndef NDEBUG
@@ -292,6 +538,419 @@ void MemoryCalendar::Private::insertIncidence(const Incidence::Ptr &incidence)
 #endif
     }
 }
+
+void MemoryCalendar::Private::indexEventSpan(const Incidence::Ptr &incidence)
+{
+    const auto event = incidence.staticCast<Event>();
+    const QDateTime start = event->dtStart();
+    const QDateTime end = event->recurs() ? QDateTime() : event->dtEnd();
+
+    EventSpanKey key{std::numeric_limits<qint64>::min(), &MemoryCalendarIndex::mRecurringEventSpans};
+    qint64 endBound = std::numeric_limits<qint64>::max();
+    if (start.isValid()) {
+        key.start = start.toMSecsSinceEpoch();
+        if (end.isValid()) {
+            key.tree = event->isMultiDay() ? &MemoryCalendarIndex::mMultiDayEventSpans : &MemoryCalendarIndex::mEventSpans;
+            endBound = end.toMSecsSinceEpoch();
+        } else if (event->recurs() && event->recurrence()->duration() >= 0) {
+            // rawEvents() compares the last day of the recurrence in the requested
+            // time zone, which ends at the latest about a day after it ends in UTC.
+            // rawEventsForDate() also returns the last occurrence on the following
+            // days it extends over.
+            const QDate endDate = event->recurrence()->endDate();
+            if (endDate.isValid()) {
+                const qint64 extraDays = std::max<qint64>(0, start.date().daysTo(event->dtEnd().date()));
+                endBound = QDateTime(endDate.addDays(2 + extraDays), QTime(0, 0), QTimeZone::utc()).toMSecsSinceEpoch();
+            }
+        }
+    }
+
+    (this->*key.tree).insert(key.start, endBound, incidence);
+    mEventSpanKeys.insert(incidence.data(), key);
+}
+
+void MemoryCalendar::Private::unindexEventSpan(const Incidence::Ptr &incidence)
+{
+    const auto it = mEventSpanKeys.constFind(incidence.data());
+    if (it == mEventSpanKeys.cend()) {
+        return;
+    }
+    (this->*it->tree).remove(it->start, incidence);
+    mEventSpanKeys.erase(it);
+}
+
+void MemoryCalendar::Private::indexLookupKeys(const Incidence::Ptr &incidence)
+{
+    LookupKeys keys{incidence->schedulingID(), incidence->relatedTo(Incidence::RelTypeParent), {}, incidence->categories()};
+    for (auto relType : {Incidence::RelTypeParent, Incidence::RelTypeChild, Incidence::RelTypeSibling}) {
+        const QString uid = incidence->relatedTo(relType);
+        if (!uid.isEmpty() && !keys.relatedTo.contains(uid)) {
+            keys.relatedTo.append(uid);
+        }
+    }
+
+    mIncidencesBySchedulingId.insert(keys.schedulingId, incidence);
+    if (!keys.parent.isEmpty()) {
+        mChildIncidences.insert(keys.parent, incidence);
+    }
+    for (const QString &uid : std::as_const(keys.relatedTo)) {
+        mIncidencesByRelatedTo.insert(uid, incidence);
+    }
+    for (const QString &category : std::as_const(keys.categories)) {
+        if (!mIncidencesByCategory.contains(category)) {
+            mCategories.append(category);
+        }
+        mIncidencesByCategory.insert(category, incidence);
+    }
+
+    if (incidence->type() == Incidence::TypeTodo) {
+        const auto todo = incidence.staticCast<Todo>();
+        const Attendee::List attendees = todo->attendees();
+        for (const Attendee &attendee : attendees) {
+            if (!keys.attendees.contains(attendee.email())) {
+                keys.attendees.append(attendee.email());
+            }
+        }
+        if (keys.attendees.isEmpty()) {
+            keys.attendees.append(QString());
+        }
+        for (const QString &email : std::as_const(keys.attendees)) {
+            mTodosByAttendee.insert(email, incidence);
+        }
+
+        keys.completed = todo->isCompleted();
+        if (keys.completed) {
+            // Without a date, completion can't be compared: always a candidate
+            const QDateTime completed = todo->completed();
+            keys.completedAt = completed.isValid() ? completed.toMSecsSinceEpoch() : std::numeric_limits<qint64>::max();
+            mCompletedTodos.insert(keys.completedAt, incidence);
+        } else {
+            mOpenTodos.insert(incidence.data(), incidence);
+        }
+    }
+    mLookupKeys.insert(incidence.data(), std::move(keys));
+}
+
+void MemoryCalendar::Private::unindexLookupKeys(const Incidence::Ptr &incidence)
+{
+    const auto it = mLookupKeys.constFind(incidence.data());
+    if (it == mLookupKeys.cend()) {
+        return;
+    }
+    mIncidencesBySchedulingId.remove(it->schedulingId, incidence);
+    if (!it->parent.isEmpty()) {
+        mChildIncidences.remove(it->parent, incidence);
+    }
+    for (const QString &uid : it->relatedTo) {
+        mIncidencesByRelatedTo.remove(uid, incidence);
+    }
+    for (const QString &category : it->categories) {
+        mIncidencesByCategory.remove(category, incidence);
+        if (!mIncidencesByCategory.contains(category)) {
+            mCategories.removeOne(category);
+        }
+    }
+    for (const QString &email : it->attendees) {
+        mTodosByAttendee.remove(email, incidence);
+    }
+    if (incidence->type() == Incidence::TypeTodo) {
+        if (it->completed) {
+            mCompletedTodos.remove(it->completedAt, incidence);
+        } else {
+            mOpenTodos.remove(incidence.data());
+        }
+    }
+    mLookupKeys.erase(it);
+}
+
+Incidence::Ptr MemoryCalendar::Private::mainIncidence(const QString &uid) const
+{
+    for (auto type : {Incidence::TypeTodo, Incidence::TypeEvent, Incidence::TypeJournal}) {
+        if (Incidence::Ptr incidence = findIncidence(mIncidences[type], uid, {})) {
+            return incidence;
+        }
+    }
+    return {};
+}
+
+// Sets candidates to the incidences of a type which may pass the filter, as
+// found in the index the criteria of the filter select the fewest incidences
+// from. Returns false if no index applies, every incidence being a candidate.
+bool MemoryCalendar::Private::filterCandidates(const CalFilter *filter, Incidence::IncidenceType type, Incidence::List &candidates) const
+{
+    if (!filter || !filter->isEnabled()) {
+        return false;
+    }
+    const int criteria = filter->criteria();
+    const QStringList categories = filter->categoryList();
+    QStringList emails = filter->emailList();
+    emails.append(QString());
+    // A day of margin for a completion date in a time zone with daylight saving time
+    const qint64 recent = QDateTime::currentDateTimeUtc().addDays(-filter->completedTimeSpan() - 1).toMSecsSinceEpoch();
+    const auto recentlyCompleted = mCompletedTodos.lowerBound(recent);
+
+    enum { NoIndex, CategoryIndex, AttendeeIndex, CompletionIndex } index = NoIndex;
+    qsizetype fewest = mIncidences[type].size();
+    if (criteria & CalFilter::ShowCategories) {
+        qsizetype count = 0;
+        for (const QString &category : categories) {
+            count += mIncidencesByCategory.count(category);
+        }
+        if (count < fewest) {
+            fewest = count;
+            index = CategoryIndex;
+        }
+    }
+    if (type == Incidence::TypeTodo && (criteria & CalFilter::HideNoMatchingAttendeeTodos)) {
+        qsizetype count = 0;
+        for (const QString &email : std::as_const(emails)) {
+            count += mTodosByAttendee.count(email);
+        }
+        if (count < fewest) {
+            fewest = count;
+            index = AttendeeIndex;
+        }
+    }
+    if (type == Incidence::TypeTodo && (criteria & (CalFilter::HideCompletedTodos | CalFilter::HideInactiveTodos))) {
+        qsizetype count = mOpenTodos.size();
+        if (!(criteria & CalFilter::HideInactiveTodos)) {
+            count += std::distance(recentlyCompleted, mCompletedTodos.cend());
+        }
+        if (count < fewest) {
+            fewest = count;
+            index = CompletionIndex;
+        }
+    }
+
+    QSet<const Incidence *> found;
+    const auto add = [&](const Incidence::Ptr &incidence) {
+        if (incidence->type() == type && !found.contains(incidence.data())) {
+            found.insert(incidence.data());
+            candidates.append(incidence);
+        }
+    };
+    switch (index) {
+    case NoIndex:
+        return false;
+    case CategoryIndex:
+        for (const QString &category : categories) {
+            for (auto it = mIncidencesByCategory.constFind(category), end = mIncidencesByCategory.cend(); it != end && it.key() == category; ++it) {
+                add(it.value());
+            }
+        }
+        break;
+    case AttendeeIndex:
+        for (const QString &email : std::as_const(emails)) {
+            for (auto it = mTodosByAttendee.constFind(email), end = mTodosByAttendee.cend(); it != end && it.key() == email; ++it) {
+                add(it.value());
+            }
+        }
+        break;
+    case CompletionIndex:
+        for (const Incidence::Ptr &todo : mOpenTodos) {
+            add(todo);
+        }
+        if (!(criteria & CalFilter::HideInactiveTodos)) {
+            for (auto it = recentlyCompleted; it != mCompletedTodos.cend(); ++it) {
+                add(it.value());
+            }
+        }
+        break;
+    }
+    return true;
+}
+
+bool MemoryCalendar::Private::inOccurrenceWindow(const QDate &date) const
+{
+    return std::abs(monthIndex(date) - monthIndex(QDate::currentDate())) <= occurrenceWindowMonths;
+}
+
+void MemoryCalendar::Private::expandOccurrences(const QDate &date)
+{
+    const int month = monthIndex(date);
+    if (mExpandedMonths.contains(month)) {
+        return;
+    }
+    pruneOccurrences();
+    mExpandedMonths.insert(month);
+    for (const auto &incidence : std::as_const(mIncidences[Incidence::TypeEvent])) {
+        indexOccurrences(incidence, month);
+    }
+}
+
+void MemoryCalendar::Private::pruneOccurrences()
+{
+    // Forget the months the window has slid past.
+    QSet<int> expired;
+    for (const int month : std::as_const(mExpandedMonths)) {
+        if (!inOccurrenceWindow(QDate(month / 12, month % 12 + 1, 1))) {
+            expired.insert(month);
+        }
+    }
+    if (expired.isEmpty()) {
+        return;
+    }
+    for (auto it = mOccurrencesForDate.begin(); it != mOccurrencesForDate.end();) {
+        it = expired.contains(monthIndex(it.key())) ? mOccurrencesForDate.erase(it) : std::next(it);
+    }
+    for (auto &days : mOccurrenceDays) {
+        days.removeIf([&expired](const QDate &day) {
+            return expired.contains(monthIndex(day));
+        });
+    }
+    mExpandedMonths.subtract(expired);
+}
+
+void MemoryCalendar::Private::indexOccurrences(const Incidence::Ptr &incidence, int month)
+{
+    if (!incidence->recurs()) {
+        return;
+    }
+    const auto event = incidence.staticCast<Event>();
+    const QTimeZone &ts = mTimeZone;
+    const QDate first(month / 12, month % 12 + 1, 1);
+    const QDate last = first.addDays(first.daysInMonth() - 1);
+    const int extraDays = event->isMultiDay() ? event->dtStart().date().daysTo(event->dtEnd().date()) : 0;
+
+    // The start days are those for which recursOn() is true, so that the index
+    // matches what rawEventsForDate() always returned.
+    const QList<QDate> starts = event->recurrence()->recurringDays(first.addDays(-extraDays), last, ts);
+
+    QList<QDate> &days = mOccurrenceDays[incidence.data()];
+    QDate next = first; // first day not indexed yet, as the starts are in order
+    for (const QDate &start : starts) {
+        const QDate end = std::min(start.addDays(extraDays), last);
+        for (QDate day = std::max(start, next); day <= end; day = day.addDays(1)) {
+            mOccurrencesForDate.insert(day, incidence);
+            days.append(day);
+        }
+        next = std::max(next, end.addDays(1));
+    }
+}
+
+void MemoryCalendar::Private::indexOccurrences(const Incidence::Ptr &incidence)
+{
+    for (const int month : std::as_const(mExpandedMonths)) {
+        indexOccurrences(incidence, month);
+    }
+}
+
+void MemoryCalendar::Private::unindexOccurrences(const Incidence::Ptr &incidence)
+{
+    const auto it = mOccurrenceDays.constFind(incidence.data());
+    if (it == mOccurrenceDays.cend()) {
+        return;
+    }
+    for (const QDate &day : it.value()) {
+        mOccurrencesForDate.remove(day, incidence);
+    }
+    mOccurrenceDays.erase(it);
+}
+
+void MemoryCalendar::Private::clearOccurrences()
+{
+    mExpandedMonths.clear();
+    mOccurrencesForDate.clear();
+    mOccurrenceDays.clear();
+}
+
+void MemoryCalendar::Private::buildAlarmSchedule()
+{
+    if (mAlarmScheduleBuilt) {
+        return;
+    }
+    mAlarmScheduleBuilt = true;
+    if (!mAlarmsCheckedUntil.isValid()) {
+        mAlarmsCheckedUntil = QDateTime::currentDateTimeUtc();
+    }
+    for (const auto &incidence : std::as_const(mIncidences[Incidence::TypeEvent])) {
+        scheduleAlarms(incidence);
+    }
+    for (const auto &incidence : std::as_const(mIncidences[Incidence::TypeTodo])) {
+        scheduleAlarms(incidence);
+    }
+}
+
+void MemoryCalendar::Private::scheduleAlarms(const Incidence::Ptr &incidence)
+{
+    if (!mAlarmScheduleBuilt || !incidence->hasEnabledAlarms()) {
+        return;
+    }
+    if (incidence->type() == Incidence::TypeTodo) {
+        if (incidence.staticCast<Todo>()->isCompleted()) {
+            return;
+        }
+    } else if (incidence->type() != Incidence::TypeEvent) {
+        return;
+    }
+
+    QDateTime next;
+    const Alarm::List alarms = incidence->alarms();
+    for (const Alarm::Ptr &alarm : alarms) {
+        if (alarm->enabled()) {
+            const QDateTime dt = alarm->nextRepetition(mAlarmsCheckedUntil);
+            if (dt.isValid() && (!next.isValid() || dt < next)) {
+                next = dt;
+            }
+        }
+    }
+    if (next.isValid()) {
+        mAlarmScheduleEntries.insert(incidence.data(), mAlarmSchedule.emplace(next.toMSecsSinceEpoch(), incidence));
+    }
+}
+
+void MemoryCalendar::Private::unscheduleAlarms(const Incidence::Ptr &incidence)
+{
+    const auto it = mAlarmScheduleEntries.constFind(incidence.data());
+    if (it != mAlarmScheduleEntries.cend()) {
+        mAlarmSchedule.erase(it.value());
+        mAlarmScheduleEntries.erase(it);
+    }
+}
+
+bool MemoryCalendarIndex::eventInRange(const Event::Ptr &event, const QDateTime &st, const QDateTime &nd, const QTimeZone &ts, bool inclusive)
+{
+    QDateTime rStart = event->dtStart();
+    if (nd.isValid() && nd < rStart) {
+        return false;
+    }
+    if (inclusive && st.isValid() && rStart < st) {
+        return false;
+    }
+
+    if (!event->recurs()) { // non-recurring events
+        QDateTime rEnd = event->dtEnd();
+        if (st.isValid() && rEnd < st) {
+            return false;
+        }
+        if (inclusive && nd.isValid() && nd < rEnd) {
+            return false;
+        }
+    } else { // recurring events
+        switch (event->recurrence()->duration()) {
+        case -1: // infinite
+            if (inclusive) {
+                return false;
+            }
+            break;
+        case 0: // end date given
+        default: // count given
+            QDateTime rEnd(event->recurrence()->endDate(), QTime(23, 59, 59, 999), ts);
+            if (!rEnd.isValid()) {
+                return false;
+            }
+            if (st.isValid() && rEnd < st) {
+                return false;
+            }
+            if (inclusive && nd.isValid() && nd < rEnd) {
+                return false;
+            }
+            break;
+        } // switch(duration)
+    } // if(recurs)
+
+    return true;
+}
 //@endcond
 
 bool MemoryCalendar::addIncidence(const Incidence::Ptr &incidence)
@@ -347,6 +1006,11 @@ Todo::Ptr MemoryCalendar::todo(const QString &uid, const QDateTime &recurrenceId
     return d->incidence(uid, Incidence::TypeTodo, recurrenceId).staticCast<Todo>();
 }
 
+Todo::List MemoryCalendar::todos(TodoSortField sortField, SortDirection sortDirection) const
+{
+    return Calendar::sortTodos(d->filteredIncidences<Todo>(Incidence::TypeTodo), sortField, sortDirection);
+}
+
 Todo::List MemoryCalendar::rawTodos(TodoSortField sortField, SortDirection sortDirection) const
 {
     return Calendar::sortTodos(d->castIncidenceList<Todo>(d->mIncidences[Incidence::TypeTodo]), sortField, sortDirection);
@@ -450,6 +1114,60 @@ Alarm::List MemoryCalendar::alarms(const QDateTime &from, const QDateTime &to, b
     return alarmList;
 }
 
+QDateTime MemoryCalendar::alarmsCheckedUntil() const
+{
+    d->buildAlarmSchedule();
+    return d->mAlarmsCheckedUntil;
+}
+
+void MemoryCalendar::setAlarmsCheckedUntil(const QDateTime &dateTime)
+{
+    d->mAlarmsCheckedUntil = dateTime;
+    d->mAlarmSchedule.clear();
+    d->mAlarmScheduleEntries.clear();
+    d->mAlarmScheduleBuilt = false;
+    d->buildAlarmSchedule();
+}
+
+QDateTime MemoryCalendar::nextAlarmTime() const
+{
+    d->buildAlarmSchedule();
+    if (d->mAlarmSchedule.empty()) {
+        return {};
+    }
+    return QDateTime::fromMSecsSinceEpoch(d->mAlarmSchedule.begin()->first, QTimeZone::utc());
+}
+
+Alarm::List MemoryCalendar::alarmsUntil(const QDateTime &to)
+{
+    d->buildAlarmSchedule();
+    Alarm::List alarmList;
+    if (!to.isValid() || to <= d->mAlarmsCheckedUntil) {
+        return alarmList;
+    }
+
+    const QDateTime from = d->mAlarmsCheckedUntil.addSecs(1);
+    const qint64 limit = to.toMSecsSinceEpoch();
+    Incidence::List dueIncidences;
+    for (auto it = d->mAlarmSchedule.begin(); it != d->mAlarmSchedule.end() && it->first <= limit;) {
+        dueIncidences.append(it->second);
+        d->mAlarmScheduleEntries.remove(it->second.data());
+        it = d->mAlarmSchedule.erase(it);
+    }
+
+    d->mAlarmsCheckedUntil = to;
+    for (const Incidence::Ptr &incidence : std::as_const(dueIncidences)) {
+        if (incidence->recurs()) {
+            appendRecurringAlarms(alarmList, incidence, from, to);
+        } else {
+            appendAlarms(alarmList, incidence, from, to);
+        }
+        d->scheduleAlarms(incidence);
+    }
+
+    return alarmList;
+}
+
 bool MemoryCalendar::updateLastModifiedOnChange() const
 {
     return d->mUpdateLastModified;
@@ -472,10 +1190,18 @@ void MemoryCalendar::incidenceUpdate(const QString &uid, const QDateTime &recurr
         // Save it so we can detect changes to uid or recurringId.
         d->mIncidenceBeingUpdated = inc->instanceIdentifier();
 
+        QMutexLocker locker(&d->mSnapshotLock);
+        d->dropReaderCaches();
         const QDateTime dt = inc->dateTime(Incidence::RoleCalendarHashing);
         if (dt.isValid()) {
             d->mIncidencesForDate[inc->type()].remove(dt.toTimeZone(timeZone()).date(), inc);
         }
+        if (inc->type() == Incidence::TypeEvent) {
+            d->unindexEventSpan(inc);
+            d->unindexOccurrences(inc);
+        }
+        d->unindexLookupKeys(inc);
+        d->unscheduleAlarms(inc);
     }
 }
 
@@ -484,6 +1210,8 @@ void MemoryCalendar::incidenceUpdated(const QString &uid, const QDateTime &recur
     Incidence::Ptr inc = incidence(uid, recurrenceId);
 
     if (inc) {
+        QMutexLocker locker(&d->mSnapshotLock);
+        d->dropReaderCaches();
         if (d->mIncidenceBeingUpdated.isEmpty()) {
             qCWarning(KCALCORE_LOG) << "Incidence::updated() called twice without an update() call in between.";
         } else if (inc->instanceIdentifier() != d->mIncidenceBeingUpdated) {
@@ -505,6 +1233,19 @@ void MemoryCalendar::incidenceUpdated(const QString &uid, const QDateTime &recur
         if (dt.isValid()) {
             d->mIncidencesForDate[inc->type()].insert(dt.toTimeZone(timeZone()).date(), inc);
         }
+        if (inc->type() == Incidence::TypeEvent) {
+            // Recurrence changes are only signalled once they are applied, so
+            // drop any stale entry before indexing the new span.
+            d->unindexEventSpan(inc);
+            d->indexEventSpan(inc);
+            d->unindexOccurrences(inc);
+            d->indexOccurrences(inc);
+        }
+        d->unindexLookupKeys(inc);
+        d->indexLookupKeys(inc);
+        d->unscheduleAlarms(inc);
+        d->scheduleAlarms(inc);
+        locker.unlock();
 
         notifyIncidenceChanged(inc);
 
@@ -513,6 +1254,28 @@ void MemoryCalendar::incidenceUpdated(const QString &uid, const QDateTime &recur
 }
 
 Event::List MemoryCalendar::rawEventsForDate(const QDate &date, const QTimeZone &timeZone, EventSortField sortField, SortDirection sortDirection) const
+{
+    if (!date.isValid() || (timeZone.isValid() && timeZone != d->mTimeZone) || !d->inOccurrenceWindow(date)) {
+        return Calendar::sortEvents(d->rawEventsForDate(date, timeZone), sortField, sortDirection);
+    }
+
+    // Recurring events are looked up in the occurrence index rather than
+    // checking whether each of them recurs on this date.
+    Event::List eventList = d->rawEventsForDate(date, timeZone, false);
+    d->expandOccurrences(date);
+    d->forIncidences<Event>(d->mOccurrencesForDate, date, [&eventList](const Event::Ptr &event) {
+        eventList.append(event);
+    });
+    return Calendar::sortEvents(std::move(eventList), sortField, sortDirection);
+}
+
+Event::List MemoryCalendar::rawEvents(const QDate &start, const QDate &end, const QTimeZone &timeZone, bool inclusive) const
+{
+    return d->rawEvents(start, end, timeZone, inclusive);
+}
+
+//@cond PRIVATE
+Event::List MemoryCalendarIndex::rawEventsForDate(const QDate &date, const QTimeZone &timeZone, bool recurring) const
 {
     Event::List eventList;
 
@@ -521,101 +1284,91 @@ Event::List MemoryCalendar::rawEventsForDate(const QDate &date, const QTimeZone
         return eventList;
     }
 
-    if (timeZone.isValid() && timeZone != this->timeZone()) {
+    const auto ts = timeZone.isValid() ? timeZone : mTimeZone;
+    const QDateTime st(date, QTime(0, 0, 0), ts);
+    const QDateTime nd(date, QTime(23, 59, 59, 999), ts);
+    const qint64 low = st.isValid() ? st.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+    const qint64 high = nd.isValid() ? nd.toMSecsSinceEpoch() : std::numeric_limits<qint64>::max();
+
+    if (ts == mTimeZone) {
+        // Iterate over all non-recurring, single-day events that start on this date
+        forIncidences<Event>(mIncidencesForDate[Incidence::TypeEvent], date, [&eventList](const Event::Ptr &event) {
+            eventList.append(event);
+        });
+    } else {
         // We cannot use the hash table on date, since time zone is different.
-        eventList = rawEvents(date, date, timeZone, false);
-        return Calendar::sortEvents(std::move(eventList), sortField, sortDirection);
+        mEventSpans.forEachOverlapping(low, high, [&eventList, &date, &ts](const Incidence::Ptr &incidence) {
+            if (incidence->dtStart().toTimeZone(ts).date() == date) {
+                eventList.append(incidence.staticCast<Event>());
+            }
+        });
     }
 
-    // Iterate over all non-recurring, single-day events that start on this date
-    d->forIncidences<Event>(d->mIncidencesForDate[Incidence::TypeEvent], date, [&eventList](const Event::Ptr &event) {
-        eventList.append(event);
+    // Non-recurring multi-day events extending over this date
+    mMultiDayEventSpans.forEachOverlapping(low, high, [&eventList, &date, &ts](const Incidence::Ptr &incidence) {
+        const auto ev = incidence.staticCast<Event>();
+        if (ev->dtStart().toTimeZone(ts).date() <= date && ev->dtEnd().toTimeZone(ts).date() >= date) {
+            eventList.append(ev);
+        }
     });
 
-    // Iterate over all events. Look for recurring events that occur on this date
-    const auto ts = timeZone.isValid() ? timeZone : this->timeZone();
-    for (const auto &event : d->mIncidences[Incidence::TypeEvent]) {
-        const auto ev = event.staticCast<Event>();
-        if (ev->recurs()) {
-            if (ev->isMultiDay()) {
-                int extraDays = ev->dtStart().date().daysTo(ev->dtEnd().date());
-                for (int i = 0; i <= extraDays; ++i) {
-                    if (ev->recursOn(date.addDays(-i), ts)) {
-                        eventList.append(ev);
-                        break;
-                    }
-                }
-            } else {
-                if (ev->recursOn(date, ts)) {
+    if (!recurring) {
+        return eventList;
+    }
+
+    // Look for recurring events that occur on this date
+    mRecurringEventSpans.forEachOverlapping(low, high, [&eventList, &date, &ts](const Incidence::Ptr &incidence) {
+        const auto ev = incidence.staticCast<Event>();
+        if (!ev->recurs()) {
+            return;
+        }
+        if (ev->isMultiDay()) {
+            int extraDays = ev->dtStart().date().daysTo(ev->dtEnd().date());
+            for (int i = 0; i <= extraDays; ++i) {
+                if (ev->recursOn(date.addDays(-i), ts)) {
                     eventList.append(ev);
+                    break;
                 }
             }
         } else {
-            if (ev->isMultiDay()) {
-                if (ev->dtStart().toTimeZone(ts).date() <= date && ev->dtEnd().toTimeZone(ts).date() >= date) {
-                    eventList.append(ev);
-                }
+            if (ev->recursOn(date, ts)) {
+                eventList.append(ev);
             }
         }
-    }
+    });
 
-    return Calendar::sortEvents(std::move(eventList), sortField, sortDirection);
+    return eventList;
 }
 
-Event::List MemoryCalendar::rawEvents(const QDate &start, const QDate &end, const QTimeZone &timeZone, bool inclusive) const
+Event::List MemoryCalendarIndex::rawEvents(const QDate &start, const QDate &end, const QTimeZone &timeZone, bool inclusive) const
 {
     Event::List eventList;
-    const auto ts = timeZone.isValid() ? timeZone : this->timeZone();
+    const auto ts = timeZone.isValid() ? timeZone : mTimeZone;
     QDateTime st(start, QTime(0, 0, 0), ts);
     QDateTime nd(end, QTime(23, 59, 59, 999), ts);
 
-    // Get non-recurring events
-    for (const auto &e : d->mIncidences[Incidence::TypeEvent]) {
-        const auto event = e.staticCast<Event>();
-        QDateTime rStart = event->dtStart();
-        if (nd.isValid() && nd < rStart) {
-            continue;
-        }
-        if (inclusive && st.isValid() && rStart < st) {
-            continue;
+    const qint64 low = st.isValid() ? st.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+    const qint64 high = nd.isValid() ? nd.toMSecsSinceEpoch() : std::numeric_limits<qint64>::max();
+    const auto collect = [&eventList, &st, &nd, &ts, inclusive](const Incidence::Ptr &incidence) {
+        const auto event = incidence.staticCast<Event>();
+        if (eventInRange(event, st, nd, ts, inclusive)) {
+            eventList.append(event);
         }
+    };
 
-        if (!event->recurs()) { // non-recurring events
-            QDateTime rEnd = event->dtEnd();
-            if (st.isValid() && rEnd < st) {
-                continue;
-            }
-            if (inclusive && nd.isValid() && nd < rEnd) {
-                continue;
-            }
-        } else { // recurring events
-            switch (event->recurrence()->duration()) {
-            case -1: // infinite
-                if (inclusive) {
-                    continue;
-                }
-                break;
-            case 0: // end date given
-            default: // count given
-                QDateTime rEnd(event->recurrence()->endDate(), QTime(23, 59, 59, 999), ts);
-                if (!rEnd.isValid()) {
-                    continue;
-                }
-                if (st.isValid() && rEnd < st) {
-                    continue;
-                }
-                if (inclusive && nd.isValid() && nd < rEnd) {
-                    continue;
-                }
-                break;
-            } // switch(duration)
-        } // if(recurs)
-
-        eventList.append(event);
-    }
+    // Only test the events whose indexed span may intersect the requested one.
+    mEventSpans.forEachOverlapping(low, high, collect);
+    mMultiDayEventSpans.forEachOverlapping(low, high, collect);
+    mRecurringEventSpans.forEachOverlapping(low, high, collect);
 
     return eventList;
 }
+//@endcond
+
+Event::List MemoryCalendar::events(EventSortField sortField, SortDirection sortDirection) const
+{
+    return Calendar::sortEvents(d->filteredIncidences<Event>(Incidence::TypeEvent), sortField, sortDirection);
+}
 
 Event::List MemoryCalendar::rawEvents(EventSortField sortField, SortDirection sortDirection) const
 {
@@ -647,6 +1400,11 @@ Journal::Ptr MemoryCalendar::journal(const QString &uid, const QDateTime &recurr
     return d->incidence(uid, Incidence::TypeJournal, recurrenceId).staticCast<Journal>();
 }
 
+Journal::List MemoryCalendar::journals(JournalSortField sortField, SortDirection sortDirection) const
+{
+    return Calendar::sortJournals(d->filteredIncidences<Journal>(Incidence::TypeJournal), sortField, sortDirection);
+}
+
 Journal::List MemoryCalendar::rawJournals(JournalSortField sortField, SortDirection sortDirection) const
 {
     return Calendar::sortJournals(d->castIncidenceList<Journal>(d->mIncidences[Incidence::TypeJournal]), sortField, sortDirection);
@@ -673,11 +1431,212 @@ Incidence::Ptr MemoryCalendar::instance(const QString &identifier) const
     return d->mIncidencesByIdentifier.value(identifier);
 }
 
+Incidence::Ptr MemoryCalendar::incidenceFromSchedulingID(const QString &sid) const
+{
+    // Prefer events, then to-dos, like Calendar::incidenceFromSchedulingID().
+    Incidence::Ptr result;
+    for (auto it = d->mIncidencesBySchedulingId.constFind(sid), end = d->mIncidencesBySchedulingId.cend(); it != end && it.key() == sid; ++it) {
+        if (!result || it.value()->type() < result->type()) {
+            result = it.value();
+        }
+    }
+    return result;
+}
+
+Incidence::List MemoryCalendar::incidencesFromSchedulingID(const QString &sid) const
+{
+    return d->mIncidencesBySchedulingId.values(sid);
+}
+
+Incidence::List MemoryCalendar::relatedIncidences(const QString &uid) const
+{
+    return d->mIncidencesByRelatedTo.values(uid);
+}
+
+Incidence::List MemoryCalendar::childIncidences(const QString &uid) const
+{
+    return d->mChildIncidences.values(uid);
+}
+
+Incidence::List MemoryCalendar::ancestors(const QString &uid) const
+{
+    Incidence::List list;
+    QSet<QString> visited{uid};
+    Incidence::Ptr incidence = d->mainIncidence(uid);
+    while (incidence) {
+        const QString parentUid = incidence->relatedTo(Incidence::RelTypeParent);
+        if (parentUid.isEmpty() || visited.contains(parentUid)) {
+            break;
+        }
+        visited.insert(parentUid);
+        incidence = d->mainIncidence(parentUid);
+        if (incidence) {
+            list.append(incidence);
+        }
+    }
+    return list;
+}
+
+Incidence::List MemoryCalendar::descendants(const QString &uid) const
+{
+    Incidence::List list;
+    QSet<QString> visited;
+    Incidence::List stack;
+    // Depth first, the children of each incidence being pushed in reverse so
+    // that they are listed in the order childIncidences() returns them.
+    // Exceptions of a recurring incidence share its uid, so they are listed
+    // but their uid is only expanded once.
+    const auto pushChildren = [this, &visited, &stack](const QString &parentUid) {
+        visited.insert(parentUid);
+        const qsizetype top = stack.size();
+        for (auto it = d->mChildIncidences.constFind(parentUid), end = d->mChildIncidences.cend(); it != end && it.key() == parentUid; ++it) {
+            if (!visited.contains(it.value()->uid())) {
+                stack.insert(top, it.value());
+            }
+        }
+    };
+
+    pushChildren(uid);
+    while (!stack.isEmpty()) {
+        const Incidence::Ptr incidence = stack.takeLast();
+        list.append(incidence);
+        if (!visited.contains(incidence->uid())) {
+            pushChildren(incidence->uid());
+        }
+    }
+    return list;
+}
+
+bool MemoryCalendar::hasRelationCycle(const QString &uid) const
+{
+    QSet<QString> visited{uid};
+    Incidence::Ptr incidence = d->mainIncidence(uid);
+    while (incidence) {
+        const QString parentUid = incidence->relatedTo(Incidence::RelTypeParent);
+        if (parentUid.isEmpty()) {
+            return false;
+        }
+        if (visited.contains(parentUid)) {
+            return true;
+        }
+        visited.insert(parentUid);
+        incidence = d->mainIncidence(parentUid);
+    }
+    return false;
+}
+
+Incidence::List MemoryCalendar::incidences() const
+{
+    Incidence::List list = rawIncidences();
+    const CalFilter *filter = this->filter();
+    if (filter->isEnabled()) {
+        list.removeIf([filter](const Incidence::Ptr &incidence) {
+            return !filter->filterIncidence(incidence);
+        });
+    }
+    return list;
+}
+
+Incidence::List MemoryCalendar::rawIncidences() const
+{
+    QMutexLocker locker(&d->mSnapshotLock);
+    if (!d->mOrderedIncidencesValid) {
+        d->mOrderedIncidences = mergeIncidenceList(d->castIncidenceList<Event>(d->mIncidences[Incidence::TypeEvent]),
+                                                   d->castIncidenceList<Todo>(d->mIncidences[Incidence::TypeTodo]),
+                                                   d->castIncidenceList<Journal>(d->mIncidences[Incidence::TypeJournal]),
+                                                   SortDirectionAscending);
+        d->mOrderedIncidencesValid = true;
+    }
+    return d->mOrderedIncidences;
+}
+
+MemoryCalendar::Snapshot MemoryCalendar::snapshot() const
+{
+    QMutexLocker locker(&d->mSnapshotLock);
+    if (!d->mSnapshot.d) {
+        d->mSnapshot.d.reset(new Snapshot::Private(*d));
+    }
+    return d->mSnapshot;
+}
+
+MemoryCalendar::Snapshot::Snapshot() = default;
+
+MemoryCalendar::Snapshot::Snapshot(const Snapshot &other) = default;
+
+MemoryCalendar::Snapshot::~Snapshot() = default;
+
+MemoryCalendar::Snapshot &MemoryCalendar::Snapshot::operator=(const Snapshot &other) = default;
+
+QTimeZone MemoryCalendar::Snapshot::timeZone() const
+{
+    return d ? d->mTimeZone : QTimeZone();
+}
+
+Event::List MemoryCalendar::Snapshot::rawEvents(EventSortField sortField, SortDirection sortDirection) const
+{
+    if (!d) {
+        return {};
+    }
+    return Calendar::sortEvents(d->castIncidenceList<Event>(d->mIncidences[Incidence::TypeEvent]), sortField, sortDirection);
+}
+
+Event::List MemoryCalendar::Snapshot::rawEvents(const QDate &start, const QDate &end, const QTimeZone &timeZone, bool inclusive) const
+{
+    return d ? d->rawEvents(start, end, timeZone, inclusive) : Event::List();
+}
+
+Event::List MemoryCalendar::Snapshot::rawEventsForDate(const QDate &date, const QTimeZone &timeZone, EventSortField sortField, SortDirection sortDirection) const
+{
+    if (!d) {
+        return {};
+    }
+    return Calendar::sortEvents(d->rawEventsForDate(date, timeZone), sortField, sortDirection);
+}
+
+Todo::List MemoryCalendar::Snapshot::rawTodos(TodoSortField sortField, SortDirection sortDirection) const
+{
+    if (!d) {
+        return {};
+    }
+    return Calendar::sortTodos(d->castIncidenceList<Todo>(d->mIncidences[Incidence::TypeTodo]), sortField, sortDirection);
+}
+
+Journal::List MemoryCalendar::Snapshot::rawJournals(JournalSortField sortField, SortDirection sortDirection) const
+{
+    if (!d) {
+        return {};
+    }
+    return Calendar::sortJournals(d->castIncidenceList<Journal>(d->mIncidences[Incidence::TypeJournal]), sortField, sortDirection);
+}
+
+Incidence::Ptr MemoryCalendar::Snapshot::incidence(const QString &uid, const QDateTime &recurrenceId) const
+{
+    if (!d) {
+        return {};
+    }
+    for (auto type : {Incidence::TypeEvent, Incidence::TypeTodo, Incidence::TypeJournal}) {
+        if (Incidence::Ptr incidence = d->incidence(uid, type, recurrenceId)) {
+            return incidence;
+        }
+    }
+    return {};
+}
+
+Incidence::Ptr MemoryCalendar::Snapshot::instance(const QString &identifier) const
+{
+    return d ? d->mIncidencesByIdentifier.value(identifier) : Incidence::Ptr();
+}
+
 void MemoryCalendar::virtual_hook(int id, void *data)
 {
-    Q_UNUSED(id);
-    Q_UNUSED(data);
-    Q_ASSERT(false);
+    if (id == CategoriesHook) {
+        // Answered from the category index instead of scanning every incidence
+        auto categories = static_cast<CategoriesHookData *>(data);
+        categories->categories = d->mCategories;
+        categories->handled = true;
+        return;
+    }
+    Calendar::virtual_hook(id, data);
 }
 
 #include "moc_memorycalendar.cpp"
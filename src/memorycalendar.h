@@ -37,6 +37,100 @@ public:
     */
     typedef QSharedPointer<MemoryCalendar> Ptr;
 
+    /**
+      @brief
+      An immutable view of the incidences of a MemoryCalendar at one point in time.
+
+      A snapshot is obtained with MemoryCalendar::snapshot() and is not affected
+      by later changes to the calendar. Any number of threads may query a
+      snapshot, or separate copies of it, while one thread keeps modifying the
+      calendar.
+
+      Taking a snapshot costs about as much as copying a few implicitly shared
+      containers. The first modification of the calendar after a snapshot has
+      been taken copies the indexes it changes, as long as the snapshot is in use.
+
+      The incidences themselves are shared with the calendar, and must not be
+      modified while readers may use them: the writer should replace an
+      incidence with a modified copy rather than change it in place.
+
+      @since 6.0
+    */
+    class KCALENDARCORE_EXPORT Snapshot
+    {
+    public:
+        /**
+          Constructs an empty snapshot.
+        */
+        Snapshot();
+
+        /**
+          Copy constructor. This is cheap, the copies share their data.
+        */
+        Snapshot(const Snapshot &other);
+
+        /**
+          Destructor.
+        */
+        ~Snapshot();
+
+        /**
+          Assignment operator.
+        */
+        Snapshot &operator=(const Snapshot &other);
+
+        /**
+          Returns the time zone of the calendar when the snapshot was taken.
+        */
+        Q_REQUIRED_RESULT QTimeZone timeZone() const;
+
+        /**
+          @copydoc Calendar::rawEvents(EventSortField, SortDirection)const
+        */
+        Q_REQUIRED_RESULT Event::List rawEvents(EventSortField sortField = EventSortUnsorted, SortDirection sortDirection = SortDirectionAscending) const;
+
+        /**
+          @copydoc Calendar::rawEvents(const QDate &, const QDate &, const QTimeZone &, bool)const
+        */
+        Q_REQUIRED_RESULT Event::List rawEvents(const QDate &start, const QDate &end, const QTimeZone &timeZone = {}, bool inclusive = false) const;
+
+        /**
+          @copydoc MemoryCalendar::rawEventsForDate()
+        */
+        Q_REQUIRED_RESULT Event::List rawEventsForDate(const QDate &date,
+                                                       const QTimeZone &timeZone = {},
+                                                       EventSortField sortField = EventSortUnsorted,
+                                                       SortDirection sortDirection = SortDirectionAscending) const;
+
+        /**
+          @copydoc Calendar::rawTodos(TodoSortField, SortDirection)const
+        */
+        Q_REQUIRED_RESULT Todo::List rawTodos(TodoSortField sortField = TodoSortUnsorted, SortDirection sortDirection = SortDirectionAscending) const;
+
+        /**
+          @copydoc Calendar::rawJournals()
+        */
+        Q_REQUIRED_RESULT Journal::List rawJournals(JournalSortField sortField = JournalSortUnsorted,
+                                                    SortDirection sortDirection = SortDirectionAscending) const;
+
+        /**
+          @copydoc Calendar::incidence()
+        */
+        Q_REQUIRED_RESULT Incidence::Ptr incidence(const QString &uid, const QDateTime &recurrenceId = {}) const;
+
+        /**
+          @copydoc MemoryCalendar::instance()
+        */
+        Q_REQUIRED_RESULT Incidence::Ptr instance(const QString &identifier) const;
+
+    private:
+        //@cond PRIVATE
+        friend class MemoryCalendar;
+        class Private;
+        QSharedPointer<const Private> d;
+        //@endcond
+    };
+
     /**
       @copydoc Calendar::Calendar(const QTimeZone &)
     */
@@ -89,6 +183,16 @@ public:
     */
     bool deleteEventInstances(const Event::Ptr &event) override;
 
+    using Calendar::events;
+
+    /**
+      @copydoc Calendar::events(EventSortField, SortDirection)const
+
+      Only the events found in the category index are checked against
+      a filter showing some categories.
+    */
+    Q_REQUIRED_RESULT Event::List events(EventSortField sortField = EventSortUnsorted, SortDirection sortDirection = SortDirectionAscending) const override;
+
     /**
       @copydoc Calendar::rawEvents(EventSortField, SortDirection)const
     */
@@ -122,6 +226,87 @@ public:
      */
     Incidence::Ptr instance(const QString &identifier) const;
 
+    /**
+      @copydoc Calendar::incidenceFromSchedulingID()
+    */
+    Incidence::Ptr incidenceFromSchedulingID(const QString &sid) const override;
+
+    /**
+      @copydoc Calendar::incidencesFromSchedulingID()
+    */
+    Incidence::List incidencesFromSchedulingID(const QString &sid) const override;
+
+    /**
+      Returns the incidences related to the incidence with the given uid,
+      whatever the type of their relation.
+
+      @param uid the uid their Incidence::relatedTo() refers to.
+      @see Incidence::relatedTo()
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT Incidence::List relatedIncidences(const QString &uid) const;
+
+    /**
+      Returns the incidences whose parent is the incidence with the given uid,
+      as set by Incidence::setRelatedTo() with Incidence::RelTypeParent.
+
+      @param uid the uid of the parent incidence.
+      @see descendants(), ancestors()
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT Incidence::List childIncidences(const QString &uid) const;
+
+    /**
+      Returns the parent of the incidence with the given uid, its parent, and
+      so on up to the root of its hierarchy. The list stops at the first
+      parent missing from the calendar, or before an incidence would be
+      repeated if the relations contain a cycle.
+
+      @param uid the uid of the incidence.
+      @see hasRelationCycle()
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT Incidence::List ancestors(const QString &uid) const;
+
+    /**
+      Returns all the incidences below the incidence with the given uid in
+      its hierarchy, its children being followed by their own descendants.
+      Each incidence is only listed once, even if the relations contain a cycle.
+
+      @param uid the uid of the incidence.
+      @see childIncidences()
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT Incidence::List descendants(const QString &uid) const;
+
+    /**
+      Returns true if following the parents of the incidence with the given
+      uid leads back to an incidence already visited, meaning that the
+      hierarchy it belongs to contains a cycle.
+
+      @param uid the uid of the incidence.
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT bool hasRelationCycle(const QString &uid) const;
+
+    using Calendar::incidences;
+
+    /**
+      @copydoc Calendar::incidences()const
+
+      The ordered list of all the incidences is kept until the calendar
+      changes, and filtered by each call.
+    */
+    Q_REQUIRED_RESULT Incidence::List incidences() const override;
+
+    /**
+      @copydoc Calendar::rawIncidences()
+
+      The ordered list is kept until the calendar changes, so only the first
+      call after a change sorts the incidences.
+    */
+    Q_REQUIRED_RESULT Incidence::List rawIncidences() const override;
+
     /**
       @copydoc Calendar::event()
     */
@@ -151,6 +336,17 @@ public:
     */
     bool deleteTodoInstances(const Todo::Ptr &todo) override;
 
+    using Calendar::todos;
+
+    /**
+      @copydoc Calendar::todos(TodoSortField, SortDirection)const
+
+      Only the to-dos found in the category, attendee or completion index,
+      whichever the filter criteria select the fewest from, are checked
+      against the filter.
+    */
+    Q_REQUIRED_RESULT Todo::List todos(TodoSortField sortField = TodoSortUnsorted, SortDirection sortDirection = SortDirectionAscending) const override;
+
     /**
       @copydoc Calendar::rawTodos(TodoSortField, SortDirection)const
     */
@@ -194,6 +390,17 @@ public:
     */
     bool deleteJournalInstances(const Journal::Ptr &journal) override;
 
+    using Calendar::journals;
+
+    /**
+      @copydoc Calendar::journals(JournalSortField, SortDirection)const
+
+      Only the journals found in the category index are checked against
+      a filter showing some categories.
+    */
+    Q_REQUIRED_RESULT Journal::List journals(JournalSortField sortField = JournalSortUnsorted,
+                                             SortDirection sortDirection = SortDirectionAscending) const override;
+
     /**
       @copydoc Calendar::rawJournals()
     */
@@ -225,6 +432,64 @@ public:
     */
     Q_REQUIRED_RESULT Alarm::List alarms(const QDateTime &from, const QDateTime &to, bool excludeBlockedAlarms = false) const override;
 
+    /**
+      Returns the time up to which alarms have been returned by alarmsUntil().
+
+      Unless set with setAlarmsCheckedUntil(), this is initially the time at
+      which the alarm schedule was first used.
+
+      @see nextAlarmTime(), alarmsUntil()
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT QDateTime alarmsCheckedUntil() const;
+
+    /**
+      Sets the time up to which alarms are considered as already returned,
+      and rebuilds the alarm schedule from there.
+
+      @param dateTime alarms triggering at or before this time are not returned
+      by alarmsUntil().
+      @since 6.0
+    */
+    void setAlarmsCheckedUntil(const QDateTime &dateTime);
+
+    /**
+      Returns the earliest time after alarmsCheckedUntil() at which an alarm of an
+      event or incomplete to-do of this calendar triggers.
+
+      The calendar keeps a schedule of the next alarm time of each incidence,
+      updated as incidences are added, changed or deleted, so this is cheap
+      to call regularly.
+
+      @return the next alarm time in UTC, or an invalid QDateTime if no alarm is pending.
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT QDateTime nextAlarmTime() const;
+
+    /**
+      Returns the alarms triggering after alarmsCheckedUntil() and at or before
+      @p to, then sets alarmsCheckedUntil() to @p to.
+
+      Unlike alarms(), only the incidences having an alarm due in that period
+      are examined.
+
+      @param to the end of the period to return alarms for.
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT Alarm::List alarmsUntil(const QDateTime &to);
+
+    /**
+      Returns a snapshot of the incidences of the calendar, which can be
+      queried from any thread while the calendar is being modified.
+
+      This method may be called from any thread. All other methods, including
+      the queries, must only be called from the thread modifying the calendar.
+
+      @see Snapshot
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT Snapshot snapshot() const;
+
     /**
       Return true if the memory calendar is updating the lastModified field
       of incidence owned by the calendar on any incidence change.
@@ -22,6 +22,9 @@
 
 #include <QDate>
 
+#include <algorithm>
+#include <vector>
+
 using namespace KCalendarCore;
 
 /**
@@ -102,6 +105,77 @@ public:
         return QDateTime();
     }
 
+    /*
+     * State of the iteration over the occurrences of one recurring incidence,
+     * tracking which exception currently overrides the occurrences.
+     */
+    struct Series {
+        Incidence::Ptr main;
+        QHash<QDateTime, Incidence::Ptr> recurrenceIds;
+        Incidence::Ptr incidence;
+        Incidence::Ptr lastInc;
+        qint64 offset = 0;
+        qint64 lastOffset = 0;
+        QDateTime lastRecurrenceId;
+    };
+
+    Series makeSeries(const Calendar &calendar, const Incidence::Ptr &inc)
+    {
+        Series series;
+        series.main = inc;
+        series.incidence = inc;
+        series.lastInc = inc;
+        QDateTime incidenceRecStart = inc->dateTime(Incidence::RoleRecurrenceStart);
+        const auto lstInstances = calendar.instances(inc);
+        for (const Incidence::Ptr &exception : lstInstances) {
+            if (incidenceRecStart.isValid()) {
+                series.recurrenceIds.insert(exception->recurrenceId().toTimeZone(incidenceRecStart.timeZone()), exception);
+            }
+        }
+        return series;
+    }
+
+    /*
+     * Computes the occurrence of @p series at @p recurrenceId, applying its exceptions.
+     * Returns false if that occurrence is hidden.
+     */
+    bool seriesOccurrence(const Calendar &calendar, Series &series, const QDateTime &recurrenceId, Occurrence &occurrence)
+    {
+        QDateTime occurrenceStartDate = recurrenceId;
+
+        bool resetIncidence = false;
+        if (series.recurrenceIds.contains(recurrenceId)) {
+            // TODO: exclude exceptions where the start/end is not within
+            // (so the occurrence of the recurrence is omitted, but no exception is added)
+            series.incidence = series.recurrenceIds.value(recurrenceId);
+            occurrenceStartDate = series.incidence->dtStart();
+            resetIncidence = !series.incidence->thisAndFuture();
+            series.offset = series.incidence->recurrenceId().secsTo(series.incidence->dtStart());
+            if (series.incidence->thisAndFuture()) {
+                series.lastInc = series.incidence;
+                series.lastOffset = series.offset;
+            }
+        } else if (series.main != series.incidence) { // thisAndFuture exception is active
+            occurrenceStartDate = occurrenceStartDate.addSecs(series.offset);
+        }
+
+        const bool hidden = occurrenceIsHidden(calendar, series.incidence, occurrenceStartDate);
+        if (!hidden) {
+            const Period period = series.main->recurrence()->rDateTimePeriod(occurrenceStartDate);
+            if (period.isValid()) {
+                occurrence = Private::Occurrence(series.incidence, recurrenceId, occurrenceStartDate, period.end());
+            } else {
+                occurrence = Private::Occurrence(series.incidence, recurrenceId, occurrenceStartDate, occurrenceEnd(series.incidence, occurrenceStartDate));
+            }
+        }
+
+        if (resetIncidence) {
+            series.incidence = series.lastInc;
+            series.offset = series.lastOffset;
+        }
+        return !hidden;
+    }
+
     void setupIterator(const Calendar &calendar, const Incidence::List &incidences)
     {
         for (const Incidence::Ptr &inc : std::as_const(incidences)) {
@@ -109,52 +183,12 @@ public:
                 continue;
             }
             if (inc->recurs()) {
-                QHash<QDateTime, Incidence::Ptr> recurrenceIds;
-                QDateTime incidenceRecStart = inc->dateTime(Incidence::RoleRecurrenceStart);
-                // const bool isAllDay = inc->allDay();
-                const auto lstInstances = calendar.instances(inc);
-                for (const Incidence::Ptr &exception : lstInstances) {
-                    if (incidenceRecStart.isValid()) {
-                        recurrenceIds.insert(exception->recurrenceId().toTimeZone(incidenceRecStart.timeZone()), exception);
-                    }
-                }
+                Series series = makeSeries(calendar, inc);
                 const auto occurrences = inc->recurrence()->timesInInterval(start, end);
-                Incidence::Ptr incidence(inc);
-                Incidence::Ptr lastInc(inc);
-                qint64 offset(0);
-                qint64 lastOffset(0);
-                QDateTime occurrenceStartDate;
+                Occurrence occurrence;
                 for (const auto &recurrenceId : std::as_const(occurrences)) {
-                    occurrenceStartDate = recurrenceId;
-
-                    bool resetIncidence = false;
-                    if (recurrenceIds.contains(recurrenceId)) {
-                        // TODO: exclude exceptions where the start/end is not within
-                        // (so the occurrence of the recurrence is omitted, but no exception is added)
-                        incidence = recurrenceIds.value(recurrenceId);
-                        occurrenceStartDate = incidence->dtStart();
-                        resetIncidence = !incidence->thisAndFuture();
-                        offset = incidence->recurrenceId().secsTo(incidence->dtStart());
-                        if (incidence->thisAndFuture()) {
-                            lastInc = incidence;
-                            lastOffset = offset;
-                        }
-                    } else if (inc != incidence) { // thisAndFuture exception is active
-                        occurrenceStartDate = occurrenceStartDate.addSecs(offset);
-                    }
-
-                    if (!occurrenceIsHidden(calendar, incidence, occurrenceStartDate)) {
-                        const Period period = inc->recurrence()->rDateTimePeriod(occurrenceStartDate);
-                        if (period.isValid()) {
-                            occurrenceList << Private::Occurrence(incidence, recurrenceId, occurrenceStartDate, period.end());
-                        } else {
-                            occurrenceList << Private::Occurrence(incidence, recurrenceId, occurrenceStartDate, occurrenceEnd(incidence, occurrenceStartDate));
-                        }
-                    }
-
-                    if (resetIncidence) {
-                        incidence = lastInc;
-                        offset = lastOffset;
+                    if (seriesOccurrence(calendar, series, recurrenceId, occurrence)) {
+                        occurrenceList << occurrence;
                     }
                 }
             } else {
@@ -164,21 +198,126 @@ public:
         }
         occurrenceIt = QListIterator<Private::Occurrence>(occurrenceList);
     }
+
+    /*
+     * Chronological mode: the next occurrence of every incidence is kept in
+     * a min-heap ordered by start date. Recurring incidences own a cursor in
+     * chronoSeries, advanced only when their pending occurrence is consumed.
+     */
+    struct PendingOccurrence {
+        Occurrence occurrence;
+        int series; // index in chronoSeries, or -1 for a single occurrence
+    };
+
+    static bool startsAfter(const PendingOccurrence &left, const PendingOccurrence &right)
+    {
+        return right.occurrence.startDate < left.occurrence.startDate;
+    }
+
+    bool chronological = false;
+    const Calendar *calendar = nullptr;
+    std::vector<Series> chronoSeries;
+    std::vector<PendingOccurrence> heap;
+
+    void pushPending(const Occurrence &occurrence, int series)
+    {
+        heap.push_back({occurrence, series});
+        std::push_heap(heap.begin(), heap.end(), startsAfter);
+    }
+
+    // Pushes the next visible occurrence of chronoSeries[index], if any.
+    void advanceSeries(int index)
+    {
+        Series &series = chronoSeries[index];
+        const Recurrence *recurrence = series.main->recurrence();
+        Occurrence occurrence;
+        for (;;) {
+            const QDateTime recurrenceId = recurrence->getNextDateTime(series.lastRecurrenceId);
+            if (!recurrenceId.isValid() || recurrenceId > end) {
+                return;
+            }
+            series.lastRecurrenceId = recurrenceId;
+
+            // Independent exceptions were queued on their own by setupChronological().
+            const auto exception = series.recurrenceIds.constFind(recurrenceId);
+            if (exception != series.recurrenceIds.cend() && !exception.value()->thisAndFuture()) {
+                continue;
+            }
+            if (seriesOccurrence(*calendar, series, recurrenceId, occurrence)) {
+                pushPending(occurrence, index);
+                return;
+            }
+        }
+    }
+
+    void setupChronological(const Calendar &cal, const Incidence::List &incidences)
+    {
+        chronological = true;
+        calendar = &cal;
+        for (const Incidence::Ptr &inc : std::as_const(incidences)) {
+            if (inc->hasRecurrenceId()) {
+                continue;
+            }
+            if (!inc->recurs()) {
+                pushPending(Private::Occurrence(inc, {}, inc->dtStart(), inc->dateTime(Incidence::RoleEnd)), -1);
+                continue;
+            }
+            if (!end.isValid() || end < inc->recurrence()->startDateTime()) {
+                // Same as timesInInterval(), which finds nothing before the recurrence starts.
+                continue;
+            }
+
+            Series series = makeSeries(cal, inc);
+            series.lastRecurrenceId = (start.isValid() ? start : inc->recurrence()->startDateTime()).addMSecs(-1);
+
+            // Exceptions which do not affect the following occurrences are queued
+            // on their own, so that they are returned at their own start date.
+            for (auto it = series.recurrenceIds.cbegin(); it != series.recurrenceIds.cend(); ++it) {
+                const QDateTime &recurrenceId = it.key();
+                if (it.value()->thisAndFuture() || (start.isValid() && recurrenceId < start) || recurrenceId > end
+                    || !inc->recurrence()->recursAt(recurrenceId)) {
+                    continue;
+                }
+                Series single = series;
+                Occurrence occurrence;
+                if (seriesOccurrence(cal, single, recurrenceId, occurrence)) {
+                    pushPending(occurrence, -1);
+                }
+            }
+
+            chronoSeries.push_back(std::move(series));
+            advanceSeries(int(chronoSeries.size()) - 1);
+        }
+    }
+
+    void nextChronological()
+    {
+        std::pop_heap(heap.begin(), heap.end(), startsAfter);
+        const PendingOccurrence pending = heap.back();
+        heap.pop_back();
+        current = pending.occurrence;
+        if (pending.series >= 0) {
+            advanceSeries(pending.series);
+        }
+    }
 };
 //@endcond
 
 /**
- * Right now there is little point in the iterator, but:
- * With an iterator it should be possible to solve this more memory efficiently
- * and with immediate results at the beginning of the selected timeframe.
- * Either all events are iterated simoulatneously, resulting in occurrences
- * of all events in parallel in the correct time-order, or incidence after
- * incidence, which would be even more efficient.
+ * In Mode::Expanded all occurrences are computed up front, incidence after
+ * incidence. Mode::Chronological iterates all incidences simultaneously instead,
+ * which is more memory efficient and gives immediate results at the beginning of
+ * the selected timeframe, with occurrences returned in the correct time-order.
  *
  * By making this class a friend of calendar, we could also use the internally
  * available data structures.
  */
 OccurrenceIterator::OccurrenceIterator(const Calendar &calendar, const QDateTime &start, const QDateTime &end)
+    : OccurrenceIterator(calendar, start, end, Mode::Expanded)
+{
+}
+
+OccurrenceIterator::OccurrenceIterator(const Calendar &calendar, const QDateTime &start, const QDateTime &end, Mode mode)
     : d(new KCalendarCore::OccurrenceIterator::Private(this))
 {
     d->start = start;
@@ -208,7 +347,11 @@ OccurrenceIterator::OccurrenceIterator(const Calendar &calendar, const QDateTime
     }
 
     const Incidence::List incidences = KCalendarCore::Calendar::mergeIncidenceList(events, todos, journals);
-    d->setupIterator(calendar, incidences);
+    if (mode == Mode::Chronological) {
+        d->setupChronological(calendar, incidences);
+    } else {
+        d->setupIterator(calendar, incidences);
+    }
 }
 
 OccurrenceIterator::OccurrenceIterator(const Calendar &calendar, const Incidence::Ptr &incidence, const QDateTime &start, const QDateTime &end)
@@ -226,12 +369,19 @@ OccurrenceIterator::~OccurrenceIterator()
 
 bool OccurrenceIterator::hasNext() const
 {
+    if (d->chronological) {
+        return !d->heap.empty();
+    }
     return d->occurrenceIt.hasNext();
 }
 
 void OccurrenceIterator::next()
 {
-    d->current = d->occurrenceIt.next();
+    if (d->chronological) {
+        d->nextChronological();
+    } else {
+        d->current = d->occurrenceIt.next();
+    }
 }
 
 Incidence::Ptr OccurrenceIterator::incidence() const
@@ -27,18 +27,53 @@ class Calendar;
  *
  * The iterator takes recurrences and exceptions to recurrences into account
  *
- * The iterator does not iterate the occurrences of all incidences chronologically.
+ * By default the iterator does not iterate the occurrences of all incidences
+ * chronologically, see Mode for an alternative.
  * @since 4.11
  */
 class KCALENDARCORE_EXPORT OccurrenceIterator
 {
 public:
+    /**
+     * How occurrences are computed and in which order they are returned.
+     * @since 6.0
+     */
+    enum class Mode {
+        /**
+         * All occurrences are computed when the iterator is created, and
+         * returned grouped by incidence.
+         */
+        Expanded,
+        /**
+         * Occurrences are computed one at a time while iterating, and returned
+         * in chronological order of their start date. Memory use is bounded by
+         * the number of incidences rather than the number of occurrences, which
+         * makes it suited for reading only the first occurrences of a long range.
+         *
+         * Exceptions moved independently (i.e. not "this and future") are
+         * returned in order of their own start date; an occurrence shifted by a
+         * "this and future" exception may be returned out of order if the shift
+         * moves it before earlier occurrences of the same series.
+         *
+         * The calendar must outlive the iterator in this mode.
+         */
+        Chronological,
+    };
+
     /**
      * Creates iterator that iterates over all occurrences of all incidences
      * between @param start and @param end (inclusive)
      */
     explicit OccurrenceIterator(const Calendar &calendar, const QDateTime &start = QDateTime(), const QDateTime &end = QDateTime());
 
+    /**
+     * Creates iterator that iterates over all occurrences of all incidences
+     * between @param start and @param end (inclusive), computing them
+     * according to @param mode.
+     * @since 6.0
+     */
+    OccurrenceIterator(const Calendar &calendar, const QDateTime &start, const QDateTime &end, Mode mode);
+
     /**
      * Creates iterator that iterates over all occurrences
      * of @param incidence between @param start and @param end (inclusive)
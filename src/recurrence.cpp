@@ -16,12 +16,18 @@
 
 #include "kcalendarcore_debug.h"
 
+#include <QAtomicInteger>
 #include <QBitArray>
 #include <QDataStream>
+#include <QMutex>
+#include <QSet>
 #include <QTime>
 #include <QTimeZone>
 #include <QHash>
 
+#include <algorithm>
+#include <memory>
+
 using namespace KCalendarCore;
 
 //@cond PRIVATE
@@ -50,6 +56,10 @@ public:
 
     bool operator==(const Private &p) const;
 
+    bool recursOn(const Recurrence *q, const QDate &qd, const QTimeZone &timeZone) const;
+
+    void clearDayCache();
+
     RecurrenceRule::List mExRules;
     RecurrenceRule::List mRRules;
     QList<QDateTime> mRDateTimes;
@@ -65,6 +75,20 @@ public:
 
     bool mAllDay = false; // the recurrence has no time, just a date
     bool mRecurReadOnly = false;
+
+    /**
+     * Result of recursOn() for each day from start, in timeZone, as built by
+     * cacheRecursOn(). It is replaced as a whole rather than modified, so that
+     * readers holding it are not affected, and reset by updated().
+     */
+    struct DayCache {
+        QTimeZone timeZone;
+        QDate start;
+        QBitArray days;
+    };
+    mutable QMutex mDayCacheLock;
+    mutable std::shared_ptr<const DayCache> mDayCache;
+    mutable QAtomicInteger<bool> mHasDayCache;
 };
 
 bool Recurrence::Private::operator==(const Recurrence::Private &p) const
@@ -200,6 +224,7 @@ void Recurrence::updated()
 {
     // recurrenceType() re-calculates the type if it's rMax
     d->mCachedType = rMax;
+    d->clearDayCache();
     for (int i = 0, end = d->mObservers.count(); i < end; ++i) {
         if (d->mObservers[i]) {
             d->mObservers[i]->recurrenceUpdated(this);
@@ -301,14 +326,87 @@ ushort Recurrence::recurrenceType(const RecurrenceRule *rrule)
 }
 
 bool Recurrence::recursOn(const QDate &qd, const QTimeZone &timeZone) const
+{
+    if (qd.isValid() && d->mHasDayCache.loadAcquire()) {
+        std::shared_ptr<const Private::DayCache> cache;
+        {
+            QMutexLocker locker(&d->mDayCacheLock);
+            cache = d->mDayCache;
+        }
+        if (cache && cache->timeZone == timeZone) {
+            const qint64 day = cache->start.daysTo(qd);
+            if (day >= 0 && day < cache->days.size()) {
+                return cache->days.testBit(day);
+            }
+        }
+    }
+    return d->recursOn(this, qd, timeZone);
+}
+
+QList<QDate> Recurrence::recurringDays(const QDate &start, const QDate &end, const QTimeZone &timeZone) const
+{
+    QList<QDate> days;
+    if (!start.isValid() || !end.isValid() || end < start) {
+        return days;
+    }
+
+    // Only the days around an occurrence can recur, so only those are checked.
+    // The day before each occurrence is a candidate too, as recursOn() also
+    // matches an occurrence at midnight on the following day.
+    QSet<QDate> candidates{startDate()};
+    const auto times = timesInInterval(QDateTime(start.addDays(-1), QTime(0, 0), timeZone), QDateTime(end.addDays(1), QTime(23, 59, 59), timeZone));
+    for (const QDateTime &dt : times) {
+        const QDate day = dt.toTimeZone(timeZone).date();
+        candidates << dt.date() << day << day.addDays(-1);
+    }
+    for (const QDate &day : std::as_const(candidates)) {
+        if (day >= start && day <= end && d->recursOn(this, day, timeZone)) {
+            days.append(day);
+        }
+    }
+    std::sort(days.begin(), days.end());
+    return days;
+}
+
+void Recurrence::cacheRecursOn(const QDate &start, const QDate &end, const QTimeZone &timeZone) const
+{
+    if (!start.isValid() || !end.isValid() || end < start) {
+        return;
+    }
+
+    auto cache = std::make_shared<Private::DayCache>();
+    cache->timeZone = timeZone;
+    cache->start = start;
+    cache->days.resize(start.daysTo(end) + 1);
+    const QList<QDate> days = recurringDays(start, end, timeZone);
+    for (const QDate &day : days) {
+        cache->days.setBit(start.daysTo(day));
+    }
+
+    QMutexLocker locker(&d->mDayCacheLock);
+    d->mDayCache = std::move(cache);
+    d->mHasDayCache.storeRelease(true);
+}
+
+//@cond PRIVATE
+void Recurrence::Private::clearDayCache()
+{
+    if (mHasDayCache.loadAcquire()) {
+        QMutexLocker locker(&mDayCacheLock);
+        mDayCache.reset();
+        mHasDayCache.storeRelease(false);
+    }
+}
+
+bool Recurrence::Private::recursOn(const Recurrence *q, const QDate &qd, const QTimeZone &timeZone) const
 {
     // Don't waste time if date is before the start of the recurrence
-    if (QDateTime(qd, QTime(23, 59, 59), timeZone) < d->mStartDateTime) {
+    if (QDateTime(qd, QTime(23, 59, 59), timeZone) < mStartDateTime) {
         return false;
     }
 
     // First handle dates. Exrules override
-    if (std::binary_search(d->mExDates.constBegin(), d->mExDates.constEnd(), qd)) {
+    if (std::binary_search(mExDates.constBegin(), mExDates.constEnd(), qd)) {
         return false;
     }
 
@@ -316,25 +414,25 @@ bool Recurrence::recursOn(const QDate &qd, const QTimeZone &timeZone) const
     int end;
     // For all-day events a matching exrule excludes the whole day
     // since exclusions take precedence over inclusions, we know it can't occur on that day.
-    if (allDay()) {
-        for (i = 0, end = d->mExRules.count(); i < end; ++i) {
-            if (d->mExRules[i]->recursOn(qd, timeZone)) {
+    if (mAllDay) {
+        for (i = 0, end = mExRules.count(); i < end; ++i) {
+            if (mExRules[i]->recursOn(qd, timeZone)) {
                 return false;
             }
         }
     }
 
-    if (std::binary_search(d->mRDates.constBegin(), d->mRDates.constEnd(), qd)) {
+    if (std::binary_search(mRDates.constBegin(), mRDates.constEnd(), qd)) {
         return true;
     }
 
     // Check if it might recur today at all.
-    bool recurs = (startDate() == qd);
-    for (i = 0, end = d->mRDateTimes.count(); i < end && !recurs; ++i) {
-        recurs = (d->mRDateTimes[i].toTimeZone(timeZone).date() == qd);
+    bool recurs = (mStartDateTime.date() == qd);
+    for (i = 0, end = mRDateTimes.count(); i < end && !recurs; ++i) {
+        recurs = (mRDateTimes[i].toTimeZone(timeZone).date() == qd);
     }
-    for (i = 0, end = d->mRRules.count(); i < end && !recurs; ++i) {
-        recurs = d->mRRules[i]->recursOn(qd, timeZone);
+    for (i = 0, end = mRRules.count(); i < end && !recurs; ++i) {
+        recurs = mRRules[i]->recursOn(qd, timeZone);
     }
     // If the event wouldn't recur at all, simply return false, don't check ex*
     if (!recurs) {
@@ -343,12 +441,12 @@ bool Recurrence::recursOn(const QDate &qd, const QTimeZone &timeZone) const
 
     // Check if there are any times for this day excluded, either by exdate or exrule:
     bool exon = false;
-    for (i = 0, end = d->mExDateTimes.count(); i < end && !exon; ++i) {
-        exon = (d->mExDateTimes[i].toTimeZone(timeZone).date() == qd);
+    for (i = 0, end = mExDateTimes.count(); i < end && !exon; ++i) {
+        exon = (mExDateTimes[i].toTimeZone(timeZone).date() == qd);
     }
-    if (!allDay()) { // we have already checked all-day times above
-        for (i = 0, end = d->mExRules.count(); i < end && !exon; ++i) {
-            exon = d->mExRules[i]->recursOn(qd, timeZone);
+    if (!mAllDay) { // we have already checked all-day times above
+        for (i = 0, end = mExRules.count(); i < end && !exon; ++i) {
+            exon = mExRules[i]->recursOn(qd, timeZone);
         }
     }
 
@@ -360,10 +458,11 @@ bool Recurrence::recursOn(const QDate &qd, const QTimeZone &timeZone) const
         // whole list of items for that day.
         // TODO: consider whether it would be more efficient to call
         //      Rule::recurTimesOn() instead of Rule::recursOn() from the start
-        TimeList timesForDay(recurTimesOn(qd, timeZone));
+        TimeList timesForDay(q->recurTimesOn(qd, timeZone));
         return !timesForDay.isEmpty();
     }
 }
+//@endcond
 
 bool Recurrence::recursAt(const QDateTime &dt) const
 {
@@ -532,6 +631,7 @@ void Recurrence::shiftTimes(const QTimeZone &oldTz, const QTimeZone &newTz)
     for (auto exR : d->mExRules) {
         exR->shiftTimes(oldTz, newTz);
     }
+    d->clearDayCache();
 }
 
 void Recurrence::unsetRecurs()
@@ -1561,6 +1661,7 @@ KCALENDARCORE_EXPORT QDataStream &KCalendarCore::operator>>(QDataStream &in, KCa
         in >> rule;
         r->d->mRRules.append(rule);
     }
+    r->d->clearDayCache();
 
     return in;
 }
@@ -187,6 +187,31 @@ public:
     */
     bool recursOn(const QDate &date, const QTimeZone &timeZone) const;
 
+    /**
+      Returns the dates from @p start to @p end, in ascending order, for which
+      recursOn() returns true in @p timeZone. Only the days around the
+      occurrences in that range are checked, rather than each date.
+
+      @param start first date to check.
+      @param end last date to check.
+      @param timeZone time zone for the dates.
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT QList<QDate> recurringDays(const QDate &start, const QDate &end, const QTimeZone &timeZone) const;
+
+    /**
+      Computes recursOn() for each date from @p start to @p end in @p timeZone
+      at once, for views querying the same dates repeatedly. recursOn() then
+      only looks up the result for those dates, until the recurrence changes
+      or another range is cached.
+
+      @param start first date to cache.
+      @param end last date to cache.
+      @param timeZone time zone for the dates.
+      @since 6.0
+    */
+    void cacheRecursOn(const QDate &start, const QDate &end, const QTimeZone &timeZone) const;
+
     /**
       Returns true if the date/time specified is one at which the event will
       recur. Times are rounded down to the nearest minute to determine the
@@ -13,15 +13,24 @@
 #include "recurrencehelper_p.h"
 #include "utils_p.h"
 
+#include <QAtomicInteger>
 #include <QDataStream>
 #include <QList>
+#include <QMutex>
 #include <QStringList>
 #include <QTime>
 
+#include <algorithm>
+#include <limits>
+
 using namespace KCalendarCore;
 
 // Maximum number of intervals to process
 const int LOOP_LIMIT = 10000;
+// Maximum number of occurrences kept in the window of a rule without a cache.
+const int WINDOW_LIMIT = 4096;
+// Number of occurrences between two checkpoints of occurrenceAt() and indexOf()
+const int CHECKPOINT_STEP = 256;
 
 #ifndef NDEBUG
 static QString dumpTime(const QDateTime &dt, bool allDay); // for debugging
@@ -709,6 +718,36 @@ public:
     Constraint getNextValidDateInterval(const QDateTime &preDate, PeriodType type) const;
     Constraint getPreviousValidDateInterval(const QDateTime &afterDate, PeriodType type) const;
     QList<QDateTime> datesForInterval(const Constraint &interval, PeriodType type) const;
+    bool expandInterval(const QDateTime &start, const QDateTime &end, QList<QDateTime> &result) const;
+    QList<QDateTime> windowTimesInInterval(const QDateTime &start, const QDateTime &end) const;
+    QDateTime windowNextDate(const QDateTime &after) const;
+    QDateTime windowPreviousDate(const QDateTime &before) const;
+    void compileFastPath();
+    QDate fastNextDate(const QDate &date) const;
+    QDate fastPreviousDate(const QDate &date) const;
+    QDateTime fastDateTime(const QDate &date) const;
+    QDateTime fastNext(const QDateTime &after) const;
+    QDateTime fastPrevious(const QDateTime &before) const;
+    bool hasClosedForm() const;
+    int fastWeekOffsets(int offsets[7]) const;
+    QDateTime closedFormOccurrence(qint64 n) const;
+    qint64 closedFormCount(const QDateTime &dt) const;
+    int countTo(const QDateTime &dt) const;
+    QList<QDateTime> nextOccurrences(const QDateTime &after, int count) const;
+    bool extendCheckpoints() const;
+    QDateTime checkpointOccurrence(int n) const;
+    QDateTime fromEpoch(qint64 msecs) const;
+    QList<QDateTime> fromEpoch(QList<qint64>::const_iterator begin, QList<qint64>::const_iterator end) const;
+    int checkpointCount(const QDateTime &dt) const;
+
+    // Rule shapes whose occurrences can be computed directly from day and
+    // month numbers, without going through the constraints.
+    enum FastPath {
+        NoFastPath,
+        DailyFastPath, // FREQ=DAILY without BY rules
+        WeeklyFastPath, // FREQ=WEEKLY with at most BYDAY without positions
+        MonthlyFastPath, // FREQ=MONTHLY with at most BYMONTHDAY
+    };
 
     RecurrenceRule *mParent;
     QString mRRule; // RRULE string
@@ -739,15 +778,39 @@ public:
     QList<RuleObserver *> mObservers;
 
     // Cache for duration
-    mutable QList<QDateTime> mCachedDates;
+    // The cached occurrences are kept as milliseconds since the epoch, all in
+    // the time zone of mDateStart, and converted back with fromEpoch().
+    mutable QList<qint64> mCachedDates;
     mutable QDateTime mCachedDateEnd;
     mutable QDateTime mCachedLastDate; // when mCachedDateEnd invalid, last date checked
-    mutable bool mCached;
+    mutable QAtomicInteger<bool> mCached;
+    mutable QMutex mCacheLock; // serializes buildCache() and the window between concurrent readers
+
+    // Window for rules without a cache (mDuration <= 0) evaluated through the
+    // constraints: all the occurrences from mWindowStart to mWindowEnd, which
+    // timesInInterval() extends on both sides as neighbouring intervals are
+    // requested.
+    mutable QDateTime mWindowStart;
+    mutable QDateTime mWindowEnd;
+    mutable QList<qint64> mWindowDates;
+
+    // Occurrences of a rule without a cache and without a closed form, for
+    // occurrenceAt() and indexOf(): mCheckpoints[i] is occurrence
+    // i * CHECKPOINT_STEP, and mCheckpointsEnd is set once the last
+    // occurrence is known to come before the next checkpoint.
+    mutable QList<qint64> mCheckpoints;
+    mutable bool mCheckpointsEnd;
 
     bool mIsReadOnly;
     bool mAllDay;
     bool mNoByRules; // no BySeconds, ByMinutes, ... rules exist
     uint mTimedRepetition; // repeats at a regular number of seconds interval, or 0
+
+    FastPath mFastPath;
+    QDate mFastPeriodStart; // first day of the period containing mDateStart
+    QTime mFastTime; // time of day of all occurrences
+    quint8 mFastWeekDays; // WeeklyFastPath: bit (n - 1) is set for weekday n
+    QList<int> mFastMonthDays; // MonthlyFastPath: days of the month
 };
 
 RecurrenceRule::Private::Private(RecurrenceRule *parent, const Private &p)
@@ -843,11 +906,42 @@ void RecurrenceRule::Private::clear()
     setDirty();
 }
 
+static QList<qint64> toEpoch(const QList<QDateTime> &dts)
+{
+    QList<qint64> result;
+    result.reserve(dts.count());
+    for (const QDateTime &dt : dts) {
+        result += dt.toMSecsSinceEpoch();
+    }
+    return result;
+}
+
+QDateTime RecurrenceRule::Private::fromEpoch(qint64 msecs) const
+{
+    return QDateTime::fromMSecsSinceEpoch(msecs, mDateStart.timeRepresentation());
+}
+
+QList<QDateTime> RecurrenceRule::Private::fromEpoch(QList<qint64>::const_iterator begin, QList<qint64>::const_iterator end) const
+{
+    const QTimeZone zone = mDateStart.timeRepresentation();
+    QList<QDateTime> result;
+    result.reserve(end - begin);
+    for (auto it = begin; it != end; ++it) {
+        result += QDateTime::fromMSecsSinceEpoch(*it, zone);
+    }
+    return result;
+}
+
 void RecurrenceRule::Private::setDirty()
 {
     buildConstraints();
-    mCached = false;
+    mCached.storeRelaxed(false);
     mCachedDates.clear();
+    mWindowStart = QDateTime();
+    mWindowEnd = QDateTime();
+    mWindowDates.clear();
+    mCheckpoints.clear();
+    mCheckpointsEnd = false;
     for (int i = 0, iend = mObservers.count(); i < iend; ++i) {
         if (mObservers[i]) {
             mObservers[i]->recurrenceChanged(mParent);
@@ -932,7 +1026,7 @@ QDateTime RecurrenceRule::endDt(bool *result) const
     }
 
     // N occurrences. Check if we have a full cache. If so, return the cached end date.
-    if (!d->mCached) {
+    if (!d->mCached.loadAcquire()) {
         // If not enough occurrences can be found (i.e. inconsistent constraints)
         if (!d->buildCache()) {
             return QDateTime();
@@ -1300,13 +1394,467 @@ void RecurrenceRule::Private::buildConstraints()
             }
         }
     }
+
+    compileFastPath();
+}
+
+void RecurrenceRule::Private::compileFastPath()
+{
+    mFastPath = NoFastPath;
+    mFastWeekDays = 0;
+    mFastMonthDays.clear();
+    if (!mDateStart.isValid() || mFrequency == 0 || mWeekStart < 1 || mWeekStart > 7 || !mBySeconds.isEmpty() || !mByMinutes.isEmpty()
+        || !mByHours.isEmpty() || !mByYearDays.isEmpty() || !mByWeekNumbers.isEmpty() || !mByMonths.isEmpty() || !mBySetPos.isEmpty()) {
+        return;
+    }
+
+    const QDate startDate = mDateStart.date();
+    switch (mPeriod) {
+    case rDaily:
+        if (!mByDays.isEmpty() || !mByMonthDays.isEmpty()) {
+            return;
+        }
+        mFastPeriodStart = startDate;
+        mFastPath = DailyFastPath;
+        break;
+    case rWeekly:
+        if (!mByMonthDays.isEmpty()) {
+            return;
+        }
+        for (const WDayPos &pos : std::as_const(mByDays)) {
+            if (pos.pos() != 0 || pos.day() < 1 || pos.day() > 7) {
+                mFastWeekDays = 0;
+                return;
+            }
+            mFastWeekDays |= 1 << (pos.day() - 1);
+        }
+        if (!mFastWeekDays) {
+            mFastWeekDays = 1 << (startDate.dayOfWeek() - 1);
+        }
+        mFastPeriodStart = startDate.addDays(-(7 + startDate.dayOfWeek() - mWeekStart) % 7);
+        mFastPath = WeeklyFastPath;
+        break;
+    case rMonthly:
+        if (!mByDays.isEmpty()) {
+            return;
+        }
+        for (int day : std::as_const(mByMonthDays)) {
+            if (day == 0 || day < -31 || day > 31) {
+                return;
+            }
+        }
+        mFastMonthDays = mByMonthDays.isEmpty() ? QList<int>{startDate.day()} : mByMonthDays;
+        mFastPeriodStart = QDate(startDate.year(), startDate.month(), 1);
+        mFastPath = MonthlyFastPath;
+        break;
+    default:
+        return;
+    }
+    const QTime time = mDateStart.time();
+    mFastTime = QTime(time.hour(), time.minute(), time.second());
+}
+
+// Return the first date on or after 'date' which is in an interval of the
+// rule and matches it, ignoring the time of day.
+QDate RecurrenceRule::Private::fastNextDate(const QDate &date) const
+{
+    QDate d = date < mFastPeriodStart ? mFastPeriodStart : date;
+    switch (mFastPath) {
+    case DailyFastPath: {
+        const qint64 r = mFastPeriodStart.daysTo(d) % mFrequency;
+        return r ? d.addDays(mFrequency - r) : d;
+    }
+    case WeeklyFastPath:
+        // At most the rest of this week, then one whole valid week
+        for (int loop = 0; loop < 16; ++loop) {
+            const qint64 weeks = mFastPeriodStart.daysTo(d) / 7;
+            const qint64 r = weeks % mFrequency;
+            if (r) {
+                d = mFastPeriodStart.addDays(7 * (weeks + mFrequency - r));
+            }
+            if (mFastWeekDays & (1 << (d.dayOfWeek() - 1))) {
+                return d;
+            }
+            d = d.addDays(1);
+        }
+        break;
+    case MonthlyFastPath: {
+        qint64 months = 12 * (d.year() - mFastPeriodStart.year()) + d.month() - mFastPeriodStart.month();
+        int fromDay = d.day();
+        for (int loop = 0; loop < LOOP_LIMIT; ++loop) {
+            const qint64 r = months % mFrequency;
+            if (r) {
+                months += mFrequency - r;
+                fromDay = 1;
+            }
+            const QDate month = mFastPeriodStart.addMonths(static_cast<int>(months));
+            const int daysInMonth = month.daysInMonth();
+            int found = 0;
+            for (int monthDay : mFastMonthDays) {
+                const int day = monthDay > 0 ? monthDay : daysInMonth + monthDay + 1;
+                if (day >= fromDay && day >= 1 && day <= daysInMonth && (!found || day < found)) {
+                    found = day;
+                }
+            }
+            if (found) {
+                return QDate(month.year(), month.month(), found);
+            }
+            months += mFrequency;
+            fromDay = 1;
+        }
+        break;
+    }
+    case NoFastPath:
+        break;
+    }
+    return QDate();
+}
+
+// Return the last date on or before 'date' which is in an interval of the
+// rule and matches it, ignoring the time of day.
+QDate RecurrenceRule::Private::fastPreviousDate(const QDate &date) const
+{
+    if (date < mFastPeriodStart) {
+        return QDate();
+    }
+    QDate d = date;
+    switch (mFastPath) {
+    case DailyFastPath:
+        return d.addDays(-(mFastPeriodStart.daysTo(d) % mFrequency));
+    case WeeklyFastPath:
+        for (int loop = 0; loop < 16 && d >= mFastPeriodStart; ++loop) {
+            const qint64 weeks = mFastPeriodStart.daysTo(d) / 7;
+            const qint64 r = weeks % mFrequency;
+            if (r) {
+                d = mFastPeriodStart.addDays(7 * (weeks - r) + 6);
+            }
+            if (mFastWeekDays & (1 << (d.dayOfWeek() - 1))) {
+                return d;
+            }
+            d = d.addDays(-1);
+        }
+        break;
+    case MonthlyFastPath: {
+        qint64 months = 12 * (d.year() - mFastPeriodStart.year()) + d.month() - mFastPeriodStart.month();
+        int toDay = d.day();
+        for (int loop = 0; loop < LOOP_LIMIT && months >= 0; ++loop) {
+            const qint64 r = months % mFrequency;
+            if (r) {
+                months -= r;
+                toDay = 31;
+            }
+            const QDate month = mFastPeriodStart.addMonths(static_cast<int>(months));
+            const int daysInMonth = month.daysInMonth();
+            int found = 0;
+            for (int monthDay : mFastMonthDays) {
+                const int day = monthDay > 0 ? monthDay : daysInMonth + monthDay + 1;
+                if (day <= toDay && day >= 1 && day <= daysInMonth && day > found) {
+                    found = day;
+                }
+            }
+            if (found) {
+                return QDate(month.year(), month.month(), found);
+            }
+            months -= mFrequency;
+            toDay = 31;
+        }
+        break;
+    }
+    case NoFastPath:
+        break;
+    }
+    return QDate();
+}
+
+// Return the occurrence on a date returned by fastNextDate() or
+// fastPreviousDate(), or an invalid date/time if the time of day does not
+// exist on that date, the same way as datesForInterval() does.
+QDateTime RecurrenceRule::Private::fastDateTime(const QDate &date) const
+{
+    const QDateTime dt(date, mFastTime, mDateStart.timeZone());
+    if (!dt.isValid() || dt.time() != mFastTime) {
+        return QDateTime();
+    }
+    return dt;
+}
+
+// Return the first occurrence after 'after', in the time zone of the rule,
+// ignoring the end of the recurrence.
+QDateTime RecurrenceRule::Private::fastNext(const QDateTime &after) const
+{
+    QDate date = after.date();
+    for (int loop = 0; loop < LOOP_LIMIT; ++loop) {
+        date = fastNextDate(date);
+        if (!date.isValid()) {
+            break;
+        }
+        const QDateTime dt = fastDateTime(date);
+        if (dt.isValid() && dt > after && dt >= mDateStart) {
+            return dt;
+        }
+        date = date.addDays(1);
+    }
+    return QDateTime();
+}
+
+// Return the last occurrence before 'before', in the time zone of the rule.
+QDateTime RecurrenceRule::Private::fastPrevious(const QDateTime &before) const
+{
+    QDate date = before.date();
+    for (int loop = 0; loop < LOOP_LIMIT; ++loop) {
+        date = fastPreviousDate(date);
+        if (!date.isValid()) {
+            break;
+        }
+        const QDateTime dt = fastDateTime(date);
+        if (dt.isValid() && dt < before) {
+            return dt >= mDateStart ? dt : QDateTime();
+        }
+        date = date.addDays(-1);
+    }
+    return QDateTime();
+}
+
+// Whether the occurrences can be counted arithmetically, ignoring the end of
+// the recurrence: sub-daily repetitions, and daily and weekly fast paths in
+// UTC, at a fixed offset from UTC or in a named zone which never changes its
+// offset (e.g. Etc/GMT-3), where every day has the same length.
+bool RecurrenceRule::Private::hasClosedForm() const
+{
+    if (mTimedRepetition) {
+        return true;
+    }
+    switch (mDateStart.timeSpec()) {
+    case Qt::UTC:
+    case Qt::OffsetFromUTC:
+        break;
+    case Qt::TimeZone:
+        if (mDateStart.timeZone().hasTransitions()) {
+            return false;
+        }
+        break;
+    default:
+        if (mDateStart.timeZone() != QTimeZone::utc()) {
+            return false;
+        }
+        break;
+    }
+    return (mFastPath == DailyFastPath || mFastPath == WeeklyFastPath) && mDateStart.time() == mFastTime;
+}
+
+// Set 'offsets' to the days of WeeklyFastPath counted from the start of the
+// week, in order, and return their number.
+int RecurrenceRule::Private::fastWeekOffsets(int offsets[7]) const
+{
+    int count = 0;
+    for (int offset = 0; offset < 7; ++offset) {
+        if (mFastWeekDays & (1 << ((mWeekStart - 1 + offset) % 7))) {
+            offsets[count++] = offset;
+        }
+    }
+    return count;
+}
+
+// Return occurrence 'n' of a rule with a closed form, ignoring the end of
+// the recurrence.
+QDateTime RecurrenceRule::Private::closedFormOccurrence(qint64 n) const
+{
+    if (mTimedRepetition) {
+        return mDateStart.addSecs(n * mTimedRepetition);
+    }
+    if (mFastPath == DailyFastPath) {
+        return fastDateTime(mFastPeriodStart.addDays(n * mFrequency));
+    }
+
+    int offsets[7];
+    const int perWeek = fastWeekOffsets(offsets);
+    // Skip the days of the first week before the start of the recurrence
+    const qint64 startOffset = mFastPeriodStart.daysTo(mDateStart.date());
+    const qint64 index = n + (std::lower_bound(offsets, offsets + perWeek, startOffset) - offsets);
+    return fastDateTime(mFastPeriodStart.addDays(7 * (index / perWeek) * mFrequency + offsets[index % perWeek]));
+}
+
+// Return the number of occurrences at or before 'dt' of a rule with a closed
+// form, ignoring the end of the recurrence. 'dt' must be in the time zone of
+// the rule.
+qint64 RecurrenceRule::Private::closedFormCount(const QDateTime &dt) const
+{
+    if (dt < mDateStart) {
+        return 0;
+    }
+    if (mTimedRepetition) {
+        return mDateStart.secsTo(dt) / mTimedRepetition + 1;
+    }
+
+    // Days from the start of the first period to the last one with an
+    // occurrence at or before dt.
+    qint64 days = mFastPeriodStart.daysTo(dt.date());
+    if (dt.time() < mFastTime) {
+        --days;
+    }
+    if (mFastPath == DailyFastPath) {
+        return days / mFrequency + 1;
+    }
+
+    int offsets[7];
+    const int perWeek = fastWeekOffsets(offsets);
+    const qint64 weeks = days / 7;
+    const qint64 startOffset = mFastPeriodStart.daysTo(mDateStart.date());
+    qint64 count = (weeks + mFrequency - 1) / mFrequency * perWeek;
+    if (weeks % mFrequency == 0) {
+        count += std::upper_bound(offsets, offsets + perWeek, days % 7) - offsets;
+    }
+    return count - (std::lower_bound(offsets, offsets + perWeek, startOffset) - offsets);
+}
+
+// Return the number of occurrences at or before 'dt', which must be in the
+// time zone of the rule and not before its start.
+int RecurrenceRule::Private::countTo(const QDateTime &dt) const
+{
+    if (hasClosedForm()) {
+        qint64 count = closedFormCount(dt);
+        if (mDuration > 0) {
+            count = qMin<qint64>(count, mDuration);
+        } else if (mDuration == 0 && dt > mDateEnd) {
+            count = closedFormCount(mDateEnd.toTimeZone(mDateStart.timeZone()));
+        }
+        return static_cast<int>(qMin<qint64>(count, std::numeric_limits<int>::max()));
+    }
+
+    if (mDuration > 0) {
+        if (!mCached.loadAcquire()) {
+            buildCache();
+        }
+        return std::upper_bound(mCachedDates.constBegin(), mCachedDates.constEnd(), dt.toMSecsSinceEpoch()) - mCachedDates.constBegin();
+    }
+
+    return checkpointCount(dt);
+}
+
+// Return up to 'count' occurrences after 'after', in order, going through
+// the fast path or the constraints. The end date is taken into account, but
+// not the number of occurrences. This does not use the caches, so it may be
+// called with mCacheLock held.
+QList<QDateTime> RecurrenceRule::Private::nextOccurrences(const QDateTime &after, int count) const
+{
+    QList<QDateTime> result;
+    const QDateTime from = after < mDateStart ? mDateStart.addSecs(-1) : after;
+    if (mFastPath != NoFastPath) {
+        for (QDateTime dt = fastNext(from); dt.isValid() && result.count() < count && (mDuration != 0 || dt <= mDateEnd); dt = fastNext(dt)) {
+            result += dt;
+        }
+        return result;
+    }
+
+    // Give up after LOOP_LIMIT intervals in a row without any occurrence
+    Constraint interval(getNextValidDateInterval(from, mPeriod));
+    for (int loop = 0; loop < LOOP_LIMIT && result.count() < count; ++loop) {
+        if (mDuration == 0 && interval.intervalDateTime(mPeriod) > mDateEnd) {
+            break;
+        }
+        const auto dts = datesForInterval(interval, mPeriod);
+        for (const QDateTime &dt : dts) {
+            if (dt <= from || dt < mDateStart) {
+                continue;
+            }
+            if (result.count() == count || (mDuration == 0 && dt > mDateEnd)) {
+                return result;
+            }
+            result += dt;
+            loop = 0;
+        }
+        interval.increase(mPeriod, mFrequency);
+    }
+    return result;
+}
+
+// Add the next checkpoint. Return false if there is none, or if the table
+// has reached its size limit. Call with mCacheLock held.
+bool RecurrenceRule::Private::extendCheckpoints() const
+{
+    if (mCheckpointsEnd || mCheckpoints.count() >= LOOP_LIMIT) {
+        return false;
+    }
+    const int count = mCheckpoints.isEmpty() ? 1 : CHECKPOINT_STEP;
+    const auto dts = nextOccurrences(mCheckpoints.isEmpty() ? mDateStart.addSecs(-1) : fromEpoch(mCheckpoints.constLast()), count);
+    if (dts.count() < count) {
+        mCheckpointsEnd = true;
+        return false;
+    }
+    mCheckpoints += dts.constLast().toMSecsSinceEpoch();
+    return true;
+}
+
+// Return occurrence 'n' of a rule without a cache, enumerating at most
+// CHECKPOINT_STEP occurrences once the checkpoints up to it are known.
+QDateTime RecurrenceRule::Private::checkpointOccurrence(int n) const
+{
+    QDateTime checkpoint;
+    {
+        QMutexLocker locker(&mCacheLock);
+        while (mCheckpoints.count() <= n / CHECKPOINT_STEP && extendCheckpoints()) { }
+        if (mCheckpoints.count() <= n / CHECKPOINT_STEP) {
+            return QDateTime();
+        }
+        checkpoint = fromEpoch(mCheckpoints.at(n / CHECKPOINT_STEP));
+    }
+    const int offset = n % CHECKPOINT_STEP;
+    if (offset == 0) {
+        return checkpoint;
+    }
+    const auto dts = nextOccurrences(checkpoint, offset);
+    return dts.count() == offset ? dts.constLast() : QDateTime();
+}
+
+// Return the number of occurrences at or before 'dt' of a rule without a
+// cache, as the number up to the last checkpoint before it plus the few
+// occurrences after that checkpoint.
+int RecurrenceRule::Private::checkpointCount(const QDateTime &dt) const
+{
+    const qint64 msecs = dt.toMSecsSinceEpoch();
+    int index;
+    QDateTime checkpoint;
+    {
+        QMutexLocker locker(&mCacheLock);
+        while ((mCheckpoints.isEmpty() || mCheckpoints.constLast() <= msecs) && extendCheckpoints()) { }
+        const auto it = std::upper_bound(mCheckpoints.constBegin(), mCheckpoints.constEnd(), msecs);
+        if (it == mCheckpoints.constBegin()) {
+            return 0;
+        }
+        index = it - mCheckpoints.constBegin() - 1;
+        checkpoint = fromEpoch(*(it - 1));
+    }
+    const auto dts = nextOccurrences(checkpoint, CHECKPOINT_STEP - 1);
+    return index * CHECKPOINT_STEP + 1 + (std::upper_bound(dts.constBegin(), dts.constEnd(), dt) - dts.constBegin());
 }
 
 // Build and cache a list of all occurrences.
 // Only call buildCache() if mDuration > 0.
+// Rules may be read from several threads at once (see MemoryCalendar::Snapshot),
+// so only one of them builds the cache while the others wait for it.
 bool RecurrenceRule::Private::buildCache() const
 {
     Q_ASSERT(mDuration > 0);
+    QMutexLocker locker(&mCacheLock);
+    if (mCached.loadRelaxed()) {
+        return mCachedDateEnd.isValid();
+    }
+
+    if (mFastPath != NoFastPath) {
+        QList<QDateTime> dts;
+        dts.reserve(mDuration);
+        for (QDateTime dt = fastNext(mDateStart.addSecs(-1)); dt.isValid() && dts.count() < mDuration; dt = fastNext(dt)) {
+            dts.append(dt);
+        }
+        if (dts.count() == mDuration) {
+            mCachedDates = toEpoch(dts);
+            mCachedDateEnd = dts.last();
+            mCached.storeRelease(true);
+            return true;
+        }
+        // Incomplete: let the constraints determine where to continue from
+    }
+
     // Build the list of all occurrences of this event (we need that to determine
     // the end date!)
     Constraint interval(getNextValidDateInterval(mDateStart, mPeriod));
@@ -1330,8 +1878,7 @@ bool RecurrenceRule::Private::buildCache() const
         // we have picked up more occurrences than necessary, remove them
         dts.erase(dts.begin() + mDuration, dts.end());
     }
-    mCached = true;
-    mCachedDates = dts;
+    mCachedDates = toEpoch(dts);
 
     // it = dts.begin();
     // while ( it != dts.end() ) {
@@ -1340,11 +1887,13 @@ bool RecurrenceRule::Private::buildCache() const
     // }
     if (int(dts.count()) == mDuration) {
         mCachedDateEnd = dts.last();
+        mCached.storeRelease(true);
         return true;
     } else {
         // The cached date list is incomplete
         mCachedDateEnd = QDateTime();
         mCachedLastDate = interval.intervalDateTime(mPeriod);
+        mCached.storeRelease(true);
         return false;
     }
 }
@@ -1386,6 +1935,10 @@ bool RecurrenceRule::recursOn(const QDate &qd, const QTimeZone &timeZone) const
             }
         }
 
+        if (d->mFastPath != Private::NoFastPath) {
+            return d->fastNextDate(qd) == qd && d->fastDateTime(qd).isValid();
+        }
+
         // The date must be in an appropriate interval (getNextValidDateInterval),
         // Plus it must match at least one of the constraints
         bool match = false;
@@ -1449,6 +2002,11 @@ bool RecurrenceRule::recursOn(const QDate &qd, const QTimeZone &timeZone) const
         return start.addSecs(d->mTimedRepetition - n) < end;
     }
 
+    if (d->mFastPath != Private::NoFastPath) {
+        const QDateTime next = d->fastNext(start.addSecs(-1));
+        return next.isValid() && next >= start && next <= end;
+    }
+
     // Find the start and end dates in the time spec for the rule
     QDate startDay = start.date();
     QDate endDay = end.addSecs(-1).date();
@@ -1521,6 +2079,11 @@ bool RecurrenceRule::recursAt(const QDateTime &kdt) const
         return !(d->mDateStart.secsTo(dt) % d->mTimedRepetition);
     }
 
+    if (d->mFastPath != Private::NoFastPath) {
+        const QDate date = dt.date();
+        return QTime(dt.time().hour(), dt.time().minute(), dt.time().second()) == d->mFastTime && d->fastNextDate(date) == date;
+    }
+
     // The date must be in an appropriate interval (getNextValidDateInterval),
     // Plus it must match at least one of the constraints
     if (!dateMatchesRules(dt)) {
@@ -1571,7 +2134,7 @@ int RecurrenceRule::durationTo(const QDateTime &dt) const
         return static_cast<int>(d->mDateStart.secsTo(toDate) / d->mTimedRepetition);
     }
 
-    return timesInInterval(d->mDateStart, toDate).count();
+    return d->countTo(toDate);
 }
 
 int RecurrenceRule::durationTo(const QDate &date) const
@@ -1579,6 +2142,40 @@ int RecurrenceRule::durationTo(const QDate &date) const
     return durationTo(QDateTime(date, QTime(23, 59, 59), d->mDateStart.timeZone()));
 }
 
+QDateTime RecurrenceRule::occurrenceAt(int n) const
+{
+    if (n < 0 || d->mPeriod == rNone || !d->mDateStart.isValid() || (d->mDuration > 0 && n >= d->mDuration)) {
+        return QDateTime();
+    }
+
+    if (d->hasClosedForm()) {
+        const QDateTime dt = d->closedFormOccurrence(n);
+        return (d->mDuration != 0 || dt <= d->mDateEnd) ? dt : QDateTime();
+    }
+
+    if (d->mDuration > 0) {
+        if (!d->mCached.loadAcquire()) {
+            d->buildCache();
+        }
+        return n < d->mCachedDates.count() ? d->fromEpoch(d->mCachedDates.at(n)) : QDateTime();
+    }
+
+    return d->checkpointOccurrence(n);
+}
+
+int RecurrenceRule::indexOf(const QDateTime &dt) const
+{
+    if (d->mPeriod == rNone || !d->mDateStart.isValid() || !dt.isValid()) {
+        return -1;
+    }
+    const QDateTime toDate(dt.toTimeZone(d->mDateStart.timeZone()));
+    if (toDate < d->mDateStart) {
+        return -1;
+    }
+    const int count = d->countTo(toDate);
+    return (count > 0 && occurrenceAt(count - 1) == toDate) ? count - 1 : -1;
+}
+
 QDateTime RecurrenceRule::getPreviousDate(const QDateTime &afterDate) const
 {
     // Convert to the time spec used by this recurrence rule
@@ -1605,12 +2202,12 @@ QDateTime RecurrenceRule::getPreviousDate(const QDateTime &afterDate) const
 
     // If we have a cache (duration given), use that
     if (d->mDuration > 0) {
-        if (!d->mCached) {
+        if (!d->mCached.loadAcquire()) {
             d->buildCache();
         }
-        const auto it = strictLowerBound(d->mCachedDates.constBegin(), d->mCachedDates.constEnd(), toDate);
+        const auto it = strictLowerBound(d->mCachedDates.constBegin(), d->mCachedDates.constEnd(), toDate.toMSecsSinceEpoch());
         if (it != d->mCachedDates.constEnd()) {
-            return *it;
+            return d->fromEpoch(*it);
         }
         return QDateTime();
     }
@@ -1620,6 +2217,17 @@ QDateTime RecurrenceRule::getPreviousDate(const QDateTime &afterDate) const
         prev = endDt().addSecs(1).toTimeZone(d->mDateStart.timeZone());
     }
 
+    if (d->mFastPath != Private::NoFastPath) {
+        return d->fastPrevious(prev);
+    }
+
+    if (d->mDuration <= 0) {
+        const QDateTime dt = d->windowPreviousDate(prev);
+        if (dt.isValid()) {
+            return dt;
+        }
+    }
+
     Constraint interval(d->getPreviousValidDateInterval(prev, recurrenceType()));
     const auto dts = d->datesForInterval(interval, recurrenceType());
     const auto it = strictLowerBound(dts.begin(), dts.end(), prev);
@@ -1667,16 +2275,28 @@ QDateTime RecurrenceRule::getNextDate(const QDateTime &preDate) const
     }
 
     if (d->mDuration > 0) {
-        if (!d->mCached) {
+        if (!d->mCached.loadAcquire()) {
             d->buildCache();
         }
-        const auto it = std::upper_bound(d->mCachedDates.constBegin(), d->mCachedDates.constEnd(), fromDate);
+        const auto it = std::upper_bound(d->mCachedDates.constBegin(), d->mCachedDates.constEnd(), fromDate.toMSecsSinceEpoch());
         if (it != d->mCachedDates.constEnd()) {
-            return *it;
+            return d->fromEpoch(*it);
         }
     }
 
     QDateTime end = endDt();
+    if (d->mFastPath != Private::NoFastPath) {
+        const QDateTime next = d->fastNext(fromDate);
+        return (next.isValid() && (d->mDuration < 0 || next <= end)) ? next : QDateTime();
+    }
+
+    if (d->mDuration <= 0) {
+        const QDateTime next = d->windowNextDate(fromDate);
+        if (next.isValid()) {
+            return (d->mDuration < 0 || next <= end) ? next : QDateTime();
+        }
+    }
+
     Constraint interval(d->getNextValidDateInterval(fromDate, recurrenceType()));
     const auto dts = d->datesForInterval(interval, recurrenceType());
     const auto it = std::upper_bound(dts.begin(), dts.end(), fromDate);
@@ -1753,19 +2373,19 @@ QList<QDateTime> RecurrenceRule::timesInInterval(const QDateTime &dtStart, const
     QDateTime st = start < d->mDateStart ? d->mDateStart : start;
     bool done = false;
     if (d->mDuration > 0) {
-        if (!d->mCached) {
+        if (!d->mCached.loadAcquire()) {
             d->buildCache();
         }
         if (d->mCachedDateEnd.isValid() && start > d->mCachedDateEnd) {
             return result; // beyond end of recurrence
         }
-        const auto it = std::lower_bound(d->mCachedDates.constBegin(), d->mCachedDates.constEnd(), start);
+        const auto it = std::lower_bound(d->mCachedDates.constBegin(), d->mCachedDates.constEnd(), start.toMSecsSinceEpoch());
         if (it != d->mCachedDates.constEnd()) {
-            const auto itEnd = std::upper_bound(it, d->mCachedDates.constEnd(), enddt);
+            const auto itEnd = std::upper_bound(it, d->mCachedDates.constEnd(), enddt.toMSecsSinceEpoch());
             if (itEnd != d->mCachedDates.constEnd()) {
                 done = true;
             }
-            std::copy(it, itEnd, std::back_inserter(result));
+            result = d->fromEpoch(it, itEnd);
         }
         if (d->mCachedDateEnd.isValid()) {
             done = true;
@@ -1780,27 +2400,125 @@ QList<QDateTime> RecurrenceRule::timesInInterval(const QDateTime &dtStart, const
         st = d->mCachedLastDate.addSecs(1);
     }
 
-    Constraint interval(d->getNextValidDateInterval(st, recurrenceType()));
-    int loop = 0;
-    do {
-        auto dts = d->datesForInterval(interval, recurrenceType());
-        auto it = dts.begin();
-        auto itEnd = dts.end();
-        if (loop == 0) {
-            it = std::lower_bound(dts.begin(), dts.end(), st);
+    if (d->mFastPath != Private::NoFastPath) {
+        QDateTime dt = d->fastNext(st.addSecs(-1));
+        if (dt.isValid() && dt < st) {
+            dt = d->fastNext(dt);
         }
-        itEnd = std::upper_bound(it, dts.end(), enddt);
-        if (itEnd != dts.end()) {
-            loop = LOOP_LIMIT;
+        for (int loop = 0; loop < LOOP_LIMIT && dt.isValid() && dt <= enddt; ++loop) {
+            result += dt;
+            dt = d->fastNext(dt);
         }
-        std::copy(it, itEnd, std::back_inserter(result));
-        // Increase the interval.
-        interval.increase(recurrenceType(), frequency());
-    } while (++loop < LOOP_LIMIT && interval.intervalDateTime(recurrenceType()) < end);
+        return result;
+    }
+
+    if (d->mDuration <= 0) {
+        return d->windowTimesInInterval(st, enddt);
+    }
+    d->expandInterval(st, enddt, result);
     return result;
 }
 
 //@cond PRIVATE
+// Appends the occurrences from start to end inclusive to result, going
+// through the constraints. Returns false if LOOP_LIMIT intervals were
+// checked before reaching end, result then being incomplete.
+bool RecurrenceRule::Private::expandInterval(const QDateTime &start, const QDateTime &end, QList<QDateTime> &result) const
+{
+    Constraint interval(getNextValidDateInterval(start, mPeriod));
+    for (int loop = 0; loop < LOOP_LIMIT; ++loop) {
+        const auto dts = datesForInterval(interval, mPeriod);
+        const auto it = loop == 0 ? std::lower_bound(dts.begin(), dts.end(), start) : dts.begin();
+        const auto itEnd = std::upper_bound(it, dts.end(), end);
+        std::copy(it, itEnd, std::back_inserter(result));
+        if (itEnd != dts.end()) {
+            return true;
+        }
+        // Increase the interval.
+        interval.increase(mPeriod, mFrequency);
+        if (interval.intervalDateTime(mPeriod) > end) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QList<QDateTime> RecurrenceRule::Private::windowTimesInInterval(const QDateTime &start, const QDateTime &end) const
+{
+    QMutexLocker locker(&mCacheLock);
+    QList<QDateTime> result;
+    if (!mWindowStart.isValid() || end < mWindowStart.addMSecs(-1) || start > mWindowEnd.addMSecs(1)) {
+        // Not adjacent to the window, start a new one.
+        if (expandInterval(start, end, result)) {
+            mWindowStart = start;
+            mWindowEnd = end;
+            mWindowDates = toEpoch(result);
+        }
+        return result;
+    }
+
+    // Only expand the parts of the interval outside the window.
+    if (start < mWindowStart) {
+        if (!expandInterval(start, mWindowStart.addMSecs(-1), result)) {
+            result.clear();
+            expandInterval(start, end, result);
+            return result;
+        }
+        mWindowDates = toEpoch(result) + mWindowDates;
+        mWindowStart = start;
+        result.clear();
+    }
+    if (end > mWindowEnd) {
+        if (!expandInterval(mWindowEnd.addMSecs(1), end, result)) {
+            result.clear();
+            expandInterval(start, end, result);
+            return result;
+        }
+        mWindowDates += toEpoch(result);
+        mWindowEnd = end;
+        result.clear();
+    }
+
+    const auto it = std::lower_bound(mWindowDates.cbegin(), mWindowDates.cend(), start.toMSecsSinceEpoch());
+    const auto itEnd = std::upper_bound(it, mWindowDates.cend(), end.toMSecsSinceEpoch());
+    if (mWindowDates.size() > WINDOW_LIMIT) {
+        // Keep the window bounded, to the interval last requested.
+        mWindowStart = start;
+        mWindowEnd = end;
+        mWindowDates = QList<qint64>(it, itEnd);
+        return fromEpoch(mWindowDates.cbegin(), mWindowDates.cend());
+    }
+    return fromEpoch(it, itEnd);
+}
+
+// Returns the first occurrence after a date/time if it is in the window,
+// or an invalid date/time if it is unknown.
+QDateTime RecurrenceRule::Private::windowNextDate(const QDateTime &after) const
+{
+    QMutexLocker locker(&mCacheLock);
+    if (mWindowStart.isValid() && after >= mWindowStart && after < mWindowEnd) {
+        const auto it = std::upper_bound(mWindowDates.cbegin(), mWindowDates.cend(), after.toMSecsSinceEpoch());
+        if (it != mWindowDates.cend()) {
+            return fromEpoch(*it);
+        }
+    }
+    return QDateTime();
+}
+
+// Returns the last occurrence before a date/time if it is in the window,
+// or an invalid date/time if it is unknown.
+QDateTime RecurrenceRule::Private::windowPreviousDate(const QDateTime &before) const
+{
+    QMutexLocker locker(&mCacheLock);
+    if (mWindowStart.isValid() && before > mWindowStart && before <= mWindowEnd) {
+        const auto it = strictLowerBound(mWindowDates.cbegin(), mWindowDates.cend(), before.toMSecsSinceEpoch());
+        if (it != mWindowDates.cend()) {
+            return fromEpoch(*it);
+        }
+    }
+    return QDateTime();
+}
+
 // Find the date/time of the occurrence at or before a date/time,
 // for a given period type.
 // Return a constraint whose value appropriate to 'type', is set to
@@ -2271,6 +2989,7 @@ KCALENDARCORE_EXPORT QDataStream &KCalendarCore::operator>>(QDataStream &in, con
         >> d->mWeekStart >> d->mConstraints >> d->mAllDay >> d->mNoByRules >> d->mTimedRepetition >> d->mIsReadOnly;
 
     d->mPeriod = static_cast<RecurrenceRule::PeriodType>(period);
+    d->compileFastPath();
 
     return in;
 }
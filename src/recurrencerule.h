@@ -173,6 +173,31 @@ public:
     /** Returns the number of recurrences up to and including the date specified. */
     Q_REQUIRED_RESULT int durationTo(const QDate &date) const;
 
+    /**
+      Returns the date and time of an occurrence, given its position in the
+      recurrence. Simple daily and weekly rules and sub-daily repetitions
+      compute it directly; other rules keep track of some of their occurrences
+      so that finding one does not enumerate all those before it.
+
+      @param n the index of the occurrence, 0 being the first one
+      @return date/time of the occurrence, or invalid date if the rule has
+      fewer occurrences.
+      @see indexOf()
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT QDateTime occurrenceAt(int n) const;
+
+    /**
+      Returns the position of an occurrence in the recurrence, the first one
+      being 0.
+
+      @param dt the date/time of the occurrence
+      @return index of the occurrence, or -1 if @p dt is not an occurrence.
+      @see occurrenceAt()
+      @since 6.0
+    */
+    Q_REQUIRED_RESULT int indexOf(const QDateTime &dt) const;
+
     /**
       Shift the times of the rule so that they appear at the same clock
       time as before but in a new time zone. The shift is done from a viewing
@@ -0,0 +1,230 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+/**
+  @file
+  This file is part of the API for handling calendar data and
+  defines the SnapshotFormat class.
+*/
+#include "snapshotformat.h"
+#include "calformat_p.h"
+#include "event.h"
+#include "journal.h"
+#include "kcalendarcore_debug.h"
+#include "todo.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+using namespace KCalendarCore;
+
+// Magic number ("KCSN") and version of the snapshot layout. Version 1 had
+// string and time zone tables, which nothing read back.
+#define KCALCORE_SNAPSHOT_MAGIC 0x4B43534E
+#define KCALCORE_SNAPSHOT_VERSION 2
+
+//@cond PRIVATE
+class KCalendarCore::SnapshotFormatPrivate : public KCalendarCore::CalFormatPrivate
+{
+public:
+    bool read(SnapshotFormat *q, const Calendar::Ptr &calendar, const QByteArray &data);
+};
+
+bool SnapshotFormatPrivate::read(SnapshotFormat *q, const Calendar::Ptr &calendar, const QByteArray &data)
+{
+    QDataStream in(data);
+
+    quint32 magic;
+    quint32 version;
+    qint32 streamVersion;
+    in >> magic >> version >> streamVersion;
+    if (in.status() != QDataStream::Ok || magic != KCALCORE_SNAPSHOT_MAGIC) {
+        qCWarning(KCALCORE_LOG) << "Invalid magic on snapshot data";
+        q->setException(new Exception(Exception::ParseErrorKcal));
+        return false;
+    }
+    if (version != KCALCORE_SNAPSHOT_VERSION || streamVersion > in.version()) {
+        qCWarning(KCALCORE_LOG) << "Unsupported snapshot version" << version << streamVersion;
+        q->setException(new Exception(Exception::CalVersionUnknown));
+        return false;
+    }
+    in.setVersion(streamVersion);
+
+    QString productId;
+    QMap<QByteArray, QString> properties;
+    quint32 count;
+    in >> productId >> properties >> count;
+    if (in.status() != QDataStream::Ok) {
+        qCWarning(KCALCORE_LOG) << "Truncated snapshot header";
+        q->setException(new Exception(Exception::ParseErrorKcal));
+        return false;
+    }
+
+    for (auto it = properties.cbegin(); it != properties.cend(); ++it) {
+        calendar->setNonKDECustomProperty(it.key(), it.value());
+    }
+    mLoadedProductId = productId;
+
+    const bool batchAdding = !calendar->batchAdding();
+    if (batchAdding) {
+        calendar->startBatchAdding();
+    }
+
+    bool success = true;
+    for (quint32 i = 0; i < count; ++i) {
+        qint32 type;
+        QByteArray record;
+        in >> type >> record;
+        if (in.status() != QDataStream::Ok) {
+            qCWarning(KCALCORE_LOG) << "Truncated snapshot record" << i;
+            success = false;
+            break;
+        }
+
+        IncidenceBase::Ptr incidence;
+        switch (type) {
+        case IncidenceBase::TypeEvent:
+            incidence = Event::Ptr(new Event);
+            break;
+        case IncidenceBase::TypeTodo:
+            incidence = Todo::Ptr(new Todo);
+            break;
+        case IncidenceBase::TypeJournal:
+            incidence = Journal::Ptr(new Journal);
+            break;
+        default:
+            // Skip records of types this version does not know about.
+            continue;
+        }
+
+        QDataStream recordStream(record);
+        recordStream.setVersion(streamVersion);
+        recordStream >> incidence;
+        if (recordStream.status() != QDataStream::Ok) {
+            qCWarning(KCALCORE_LOG) << "Invalid snapshot record" << i;
+            success = false;
+            break;
+        }
+        calendar->addIncidence(incidence.staticCast<Incidence>());
+    }
+
+    if (batchAdding) {
+        calendar->endBatchAdding();
+    }
+
+    if (!success) {
+        q->setException(new Exception(Exception::ParseErrorKcal));
+    }
+    return success;
+}
+//@endcond
+
+SnapshotFormat::SnapshotFormat()
+    : CalFormat(new SnapshotFormatPrivate)
+{
+}
+
+SnapshotFormat::~SnapshotFormat() = default;
+
+bool SnapshotFormat::load(const Calendar::Ptr &calendar, const QString &fileName)
+{
+    qCDebug(KCALCORE_LOG) << fileName;
+
+    clearException();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "load error: unable to open " << fileName;
+        setException(new Exception(Exception::LoadError));
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    file.close();
+
+    Q_D(SnapshotFormat);
+    if (!data.isEmpty() && !d->read(this, calendar, data)) {
+        qCWarning(KCALCORE_LOG) << fileName << " is not a valid calendar snapshot";
+        return false;
+    }
+
+    // Note: we consider empty files to be valid
+    return true;
+}
+
+bool SnapshotFormat::save(const Calendar::Ptr &calendar, const QString &fileName)
+{
+    qCDebug(KCALCORE_LOG) << fileName;
+
+    clearException();
+
+    const QByteArray data = toRawString(calendar);
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCritical() << "file open error: " << file.errorString() << ";filename=" << fileName;
+        setException(new Exception(Exception::SaveErrorOpenFile, QStringList(fileName)));
+        return false;
+    }
+
+    file.write(data);
+    // QSaveFile doesn't report a write error when the device is full (see Qt
+    // bug 75077), so check that the data can actually be written.
+    if (!file.flush()) {
+        qCDebug(KCALCORE_LOG) << "file write error (flush failed)";
+        setException(new Exception(Exception::SaveErrorSaveFile, QStringList(fileName)));
+        return false;
+    }
+
+    if (!file.commit()) {
+        qCDebug(KCALCORE_LOG) << "file finalize error:" << file.errorString();
+        setException(new Exception(Exception::SaveErrorSaveFile, QStringList(fileName)));
+        return false;
+    }
+
+    return true;
+}
+
+bool SnapshotFormat::fromRawString(const Calendar::Ptr &calendar, const QByteArray &string)
+{
+    Q_D(SnapshotFormat);
+
+    clearException();
+
+    QByteArray data = string;
+    if (!data.startsWith(QByteArrayView("KCSN"))) {
+        data = QByteArray::fromBase64(string.trimmed());
+    }
+    return d->read(this, calendar, data);
+}
+
+QString SnapshotFormat::toString(const Calendar::Ptr &calendar)
+{
+    return QString::fromLatin1(toRawString(calendar).toBase64());
+}
+
+QByteArray SnapshotFormat::toRawString(const Calendar::Ptr &calendar)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+
+    out << quint32(KCALCORE_SNAPSHOT_MAGIC) << quint32(KCALCORE_SNAPSHOT_VERSION) << qint32(out.version());
+
+    out << productId() << calendar->customProperties();
+
+    const Incidence::List incidences = calendar->rawIncidences();
+    out << quint32(incidences.size());
+    for (const Incidence::Ptr &incidence : incidences) {
+        QByteArray record;
+        QDataStream recordStream(&record, QIODevice::WriteOnly);
+        recordStream.setVersion(out.version());
+        recordStream << incidence.staticCast<IncidenceBase>();
+        out << qint32(incidence->type()) << record;
+    }
+
+    return data;
+}
@@ -0,0 +1,93 @@
+/*
+  This file is part of the kcalcore library.
+
+  SPDX-FileCopyrightText: 2026 The KCalendarCore authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+/**
+  @file
+  This file is part of the API for handling calendar data and
+  defines the SnapshotFormat class.
+*/
+#ifndef KCALCORE_SNAPSHOTFORMAT_H
+#define KCALCORE_SNAPSHOTFORMAT_H
+
+#include "calformat.h"
+#include "kcalendarcore_export.h"
+
+namespace KCalendarCore
+{
+class SnapshotFormatPrivate;
+
+/**
+  @brief
+  Binary snapshot format.
+
+  This class stores a whole calendar in a compact, versioned binary form
+  built on the QDataStream serialization of incidences. It is meant as a
+  cache which is much faster to load than iCalendar text, for example to
+  speed up the start of an application, not as an interchange format: use
+  ICalFormat for that.
+
+  A snapshot consists of a header (magic number, format version and
+  QDataStream version), the product ID of the writer, the custom properties
+  of the calendar and one length-prefixed record per incidence.
+
+  @since 6.0
+*/
+class KCALENDARCORE_EXPORT SnapshotFormat : public CalFormat
+{
+public:
+    /**
+      Constructs a new snapshot format object.
+    */
+    SnapshotFormat();
+
+    /**
+      Destructor.
+    */
+    ~SnapshotFormat() override;
+
+    /**
+      @copydoc
+      CalFormat::load()
+    */
+    bool load(const Calendar::Ptr &calendar, const QString &fileName) override;
+
+    /**
+      @copydoc
+      CalFormat::save()
+    */
+    bool save(const Calendar::Ptr &calendar, const QString &fileName) override;
+
+    /**
+      Loads a snapshot, either in binary form as returned by toRawString(),
+      or base64 encoded as returned by toString().
+      @param calendar is the Calendar to be loaded.
+      @param string is the snapshot data.
+      @return true if successful; false otherwise.
+    */
+    bool fromRawString(const Calendar::Ptr &calendar, const QByteArray &string) override;
+
+    /**
+      Returns the snapshot of @p calendar, base64 encoded.
+      @param calendar is the Calendar containing the data to be saved.
+    */
+    Q_REQUIRED_RESULT QString toString(const Calendar::Ptr &calendar) override;
+
+    /**
+      Returns the snapshot of @p calendar in binary form.
+      @param calendar is the Calendar containing the data to be saved.
+    */
+    Q_REQUIRED_RESULT QByteArray toRawString(const Calendar::Ptr &calendar);
+
+private:
+    //@cond PRIVATE
+    Q_DECLARE_PRIVATE(SnapshotFormat)
+    //@endcond
+};
+
+}
+
+#endif